@@ -0,0 +1,302 @@
+/* Copyright or © or Copr. Centre National de la Recherche Scientifique (CNRS) (2017/05/03)
+Contributors:
+- Vincent Lanore <vincent.lanore@gmail.com>
+
+This software is a computer program whose purpose is to provide the necessary classes to write ligntweight component-based
+c++ applications.
+
+This software is governed by the CeCILL-B license under French law and abiding by the rules of distribution of free software.
+You can use, modify and/ or redistribute the software under the terms of the CeCILL-B license as circulated by CEA, CNRS and
+INRIA at the following URL "http://www.cecill.info".
+
+As a counterpart to the access to the source code and rights to copy, modify and redistribute granted by the license, users
+are provided only with a limited warranty and the software's author, the holder of the economic rights, and the successive
+licensors have only limited liability.
+
+In this respect, the user's attention is drawn to the risks associated with loading, using, modifying and/or developing or
+reproducing the software by the user in light of its specific status of free software, that may mean that it is complicated
+to manipulate, and that also therefore means that it is reserved for developers and experienced professionals having in-depth
+computer knowledge. Users are therefore encouraged to load and test the software's suitability as regards their requirements
+in conditions enabling the security of their systems and/or data to be ensured and, more generally, to use and operate it in
+the same conditions as regards security.
+
+The fact that you are presently reading this means that you have had knowledge of the CeCILL-B license and that you accept
+its terms.*/
+
+/* Benchmarks of the framework itself (as opposed to example/perf_test.cpp which measures calls between components).
+Usage: bench_bin [--sizes 10,100,...] [--repeat N] [--output file.csv] [--compare baseline.csv] [--tolerance 0.25]
+Results are written as CSV (benchmark,size,total_ns,ns_per_element). With --compare, every result is compared to the
+baseline entry with the same benchmark and size, and the program exits with status 1 if one of them is slower than the
+baseline by more than the tolerance. */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include "tinycompo.hpp"
+
+using namespace std;
+using namespace tc;
+
+/*
+=============================================================================================================================
+  ~*~ Components ~*~
+===========================================================================================================================*/
+struct IntInterface {
+    virtual int get() const = 0;
+};
+
+struct BenchInt : public Component, public IntInterface {
+    int i;
+    explicit BenchInt(int i = 1) : i(i) { port("set", &BenchInt::set); }
+    void set(int value) { i = value; }
+    int get() const override { return i; }
+};
+
+struct BenchProxy : public Component, public IntInterface {
+    IntInterface* ptr{nullptr};
+    BenchProxy() { port("ptr", &BenchProxy::set_ptr); }
+    void set_ptr(IntInterface* ptrin) { ptr = ptrin; }
+    int get() const override { return ptr->get(); }
+};
+
+struct BenchReducer : public Component, public IntInterface {
+    vector<IntInterface*> ptrs;
+    BenchReducer() { port("ptr", &BenchReducer::add_ptr); }
+    void add_ptr(IntInterface* ptr) { ptrs.push_back(ptr); }
+    int get() const override {
+        int result = 0;
+        for (auto ptr : ptrs) {
+            result += ptr->get();
+        }
+        return result;
+    }
+};
+
+void declare(Model& model, int size, bool connect) {
+    model.component<Array<BenchInt>>("ints", size);
+    model.component<Array<BenchProxy>>("proxies", size);
+    model.component<BenchReducer>("reducer");
+    if (connect) {
+        model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+        model.connect<MultiUse<IntInterface>>(PortAddress("ptr", "reducer"), Address("proxies"));
+    }
+}
+
+void register_snapshot_types() {
+    Snapshot::register_component<BenchInt>("BenchInt");
+    Snapshot::register_component<BenchProxy>("BenchProxy");
+    Snapshot::register_component<BenchReducer>("BenchReducer");
+    Snapshot::register_component<Array<BenchInt>>("Array<BenchInt>");
+    Snapshot::register_component<Array<BenchProxy>>("Array<BenchProxy>");
+    Snapshot::register_connector<ArrayOneToOne<IntInterface>, PortAddress, Address>("ArrayOneToOne<IntInterface>");
+    Snapshot::register_connector<MultiUse<IntInterface>, PortAddress, Address>("MultiUse<IntInterface>");
+}
+
+/*
+=============================================================================================================================
+  ~*~ Measures ~*~
+===========================================================================================================================*/
+using bench_clock = chrono::steady_clock;
+
+struct Result {
+    string benchmark;
+    int size;
+    double total_ns;
+    double per_element() const { return total_ns / size; }
+};
+
+// runs setup (not measured) then f (measured) repeat times and keeps the fastest run
+double measure(int repeat, function<void()> setup, function<void()> f) {
+    double best = numeric_limits<double>::max();
+    for (int r = 0; r < repeat; r++) {
+        setup();
+        auto begin = bench_clock::now();
+        f();
+        auto end = bench_clock::now();
+        best = min(best, double(chrono::duration_cast<chrono::nanoseconds>(end - begin).count()));
+    }
+    return best;
+}
+
+volatile int sink{0};  // prevents the compiler from optimizing measured calls away
+
+vector<Result> run_all(int size, int repeat) {
+    vector<Result> results;
+    auto nothing = []() {};
+    auto add = [&](const string& name, double ns) {
+        results.push_back(Result{name, size, ns});
+        cerr << "  " << name << ": " << ns / size << " ns/element\n";
+    };
+    cerr << "size " << size << "\n";
+
+    unique_ptr<Model> model;
+    add("model_declaration", measure(repeat, [&]() { model.reset(new Model); }, [&]() { declare(*model, size, true); }));
+
+    stringstream snapshot;
+    add("snapshot_save", measure(repeat, [&]() { snapshot.str(""); }, [&]() { Snapshot::save(*model, snapshot); }));
+    add("snapshot_load", measure(repeat, [&]() { snapshot.seekg(0); }, [&]() { Snapshot::load(snapshot); }));
+
+    Model unconnected;
+    declare(unconnected, size, false);
+    unique_ptr<Assembly> assembly;
+    add("assembly_build", measure(repeat, [&]() { assembly.reset(); },
+                                  [&]() { assembly.reset(new Assembly(unconnected)); }));
+
+    add("array_connectors", measure(repeat, [&]() { assembly.reset(new Assembly(unconnected)); },
+                                    [&]() {
+                                        ArrayOneToOne<IntInterface>::_connect(*assembly, PortAddress("ptr", "proxies"),
+                                                                              Address("ints"));
+                                        MultiUse<IntInterface>::_connect(*assembly, PortAddress("ptr", "reducer"),
+                                                                         Address("proxies"));
+                                    }));
+
+    add("at_lookup", measure(repeat, nothing, [&]() {
+            for (int i = 0; i < size; i++) {
+                sink += assembly->at<BenchInt>(Address("ints", i)).i;
+            }
+        }));
+
+    auto& ints = assembly->at<Assembly>("ints");
+    add("port_set", measure(repeat, nothing, [&]() {
+            for (int i = 0; i < size; i++) {
+                ints.at(i).set("set", i);
+            }
+        }));
+
+    add("get_all", measure(repeat, nothing, [&]() { sink += assembly->get_all<IntInterface>().pointers().size(); }));
+
+    stringstream dot;
+    add("to_dot", measure(repeat, [&]() { dot.str(""); }, [&]() { model->to_dot(0, "", dot); }));
+
+    auto& reducer = assembly->at<BenchReducer>("reducer");
+    add("call_through_connectors", measure(repeat, nothing, [&]() { sink += reducer.get(); }));
+
+    Model chain;  // each proxy uses the previous one
+    chain.composite("nodes");
+    auto& nodes = chain.get_composite("nodes");
+    nodes.component<BenchInt>(0);
+    for (int i = 1; i < size; i++) {
+        nodes.component<BenchProxy>(i).connect<Use<IntInterface>>("ptr", Address(i - 1));
+    }
+    chain.component<BenchReducer>("sorted");
+    unique_ptr<Assembly> chain_assembly;
+    add("use_topo_sort", measure(repeat, [&]() { chain_assembly.reset(new Assembly(chain)); },
+                                 [&]() {
+                                     UseTopoSort<IntInterface>::_connect(*chain_assembly, PortAddress("ptr", "sorted"),
+                                                                         Address("nodes"));
+                                 }));
+
+    return results;
+}
+
+/*
+=============================================================================================================================
+  ~*~ CSV and baseline comparison ~*~
+===========================================================================================================================*/
+void write_csv(ostream& os, const vector<Result>& results) {
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(3);  // totals reach 1e9 ns, the default 6 significant digits would round them
+    os << "benchmark,size,total_ns,ns_per_element\n";
+    for (auto& r : results) {
+        os << r.benchmark << "," << r.size << "," << r.total_ns << "," << r.per_element() << "\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+map<pair<string, int>, double> read_csv(const string& file) {
+    ifstream is(file);
+    if (!is) {
+        throw TinycompoException("Could not open baseline file " + file);
+    }
+    map<pair<string, int>, double> result;
+    string line;
+    getline(is, line);  // header
+    while (getline(is, line)) {
+        stringstream ss(line);
+        string name, size, total;
+        if (getline(ss, name, ',') and getline(ss, size, ',') and getline(ss, total, ',')) {
+            result[make_pair(name, stoi(size))] = stod(total);
+        }
+    }
+    return result;
+}
+
+// returns the number of regressions; differences below min_ns are considered noise
+int compare(const vector<Result>& results, const string& baseline_file, double tolerance, double min_ns = 1e5) {
+    auto baseline = read_csv(baseline_file);
+    int regressions = 0;
+    for (auto& r : results) {
+        auto it = baseline.find(make_pair(r.benchmark, r.size));
+        if (it == baseline.end()) {
+            continue;
+        }
+        double ratio = r.total_ns / it->second;
+        bool regression = ratio > 1 + tolerance and r.total_ns - it->second > min_ns;
+        regressions += regression;
+        cout << (regression ? "REGRESSION " : "ok         ") << r.benchmark << " (size " << r.size << "): x" << ratio
+             << "\n";
+    }
+    return regressions;
+}
+
+/*
+=============================================================================================================================
+  ~*~ Main ~*~
+===========================================================================================================================*/
+int main(int argc, char** argv) {
+    vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
+    int repeat = 3;
+    string output, baseline;
+    double tolerance = 0.25;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 == argc) {
+            cerr << "Missing value for argument " << arg << "\n";
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--sizes") {
+            sizes.clear();
+            stringstream ss(value);
+            string size;
+            while (getline(ss, size, ',')) {
+                sizes.push_back(stoi(size));
+            }
+        } else if (arg == "--repeat") {
+            repeat = stoi(value);
+        } else if (arg == "--output") {
+            output = value;
+        } else if (arg == "--compare") {
+            baseline = value;
+        } else if (arg == "--tolerance") {
+            tolerance = stod(value);
+        } else {
+            cerr << "Unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+
+    register_snapshot_types();
+    vector<Result> results;
+    for (auto size : sizes) {
+        auto size_results = run_all(size, repeat);
+        results.insert(results.end(), size_results.begin(), size_results.end());
+    }
+
+    if (output.empty()) {
+        write_csv(cout, results);
+    } else {
+        ofstream os(output);
+        write_csv(os, results);
+    }
+
+    if (not baseline.empty()) {
+        int regressions = compare(results, baseline, tolerance);
+        cout << regressions << " regression(s) compared to " << baseline << "\n";
+        return regressions > 0;
+    }
+}
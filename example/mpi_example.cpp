@@ -58,9 +58,7 @@ class MyReducer : public Component, public Go {
 
     void go() override {
         int acc = 0;
-        for (auto p : ports) {
-            int receive_msg;
-            p.receive(receive_msg);
+        for (auto receive_msg : receive_all(ports)) {  // receptions from all workers overlap
             core.message("received %d", receive_msg);
             acc += receive_msg;
         }
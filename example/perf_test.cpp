@@ -79,18 +79,27 @@ int main() {
     model2.component<User<GetInt>>("user");
     model2.connect<Use<GetInt>>(PortAddress("ptr", "user"), Address("provider"));
 
+    Model model3;  // statically dispatched even if getInt were not final
+    model3.component<Sealed<RandInt>>("provider");
+    model3.component<User<Sealed<RandInt>>>("user");
+    model3.connect<StaticUse<RandInt>>(PortAddress("ptr", "user"), Address("provider"));
+
     Assembly assembly(model);
     Assembly assembly2(model2);
+    Assembly assembly3(model3);
 
     // cache heating
     assembly.call("user", "go");
     assembly2.call("user", "go");
+    assembly3.call("user", "go");
 
     double run1 = measure([&]() { assembly.call("user", "go"); });
     double run2 = measure([&]() { assembly2.call("user", "go"); });
+    double run3 = measure([&]() { assembly3.call("user", "go"); });
 
     std::cout << run1 << " ns/it\n";
     std::cout << run2 << " ns/it\n";
+    std::cout << run3 << " ns/it (StaticUse)\n";
 
     double diff = run2 - run1;
     std::cout << "Difference: " << diff << " ns/it\n";
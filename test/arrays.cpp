@@ -40,6 +40,49 @@ TEST_CASE("Array tests.") {
     CHECK(assembly.at<MyCompo>(Address("a", 0)).i == 11);
 }
 
+/*
+=============================================================================================================================
+  ~*~ FlatArray ~*~
+===========================================================================================================================*/
+struct CountedInt : public MyInt {
+    static int alive;
+    explicit CountedInt(int i = 0) : MyInt(i) { alive++; }
+    ~CountedInt() { alive--; }
+};
+int CountedInt::alive = 0;
+
+TEST_CASE("FlatArray tests.") {
+    Model model;
+    model.component<FlatArray<CountedInt>>("flat", 5, 3);
+    model.component<FlatArray<CountedInt>>("flat2", 2, 7);
+    model.component<MyIntProxy>(Address("flat2", "extra")).connect<Use<IntInterface>>("ptr", Address("flat2", 1));
+    model.component<Array<MyIntProxy>>("proxies", 5).connect<ArrayOneToOne<IntInterface>>("ptr", Address("flat"));
+    model.component<IntReducer>("reducer").connect<MultiUse<IntInterface>>("ptr", Address("flat"));
+    model.connect<ArraySet<int>>(PortAddress("set", "flat"), std::vector<int>{1, 2, 3, 4, 5});
+
+    {
+        Assembly assembly(model);
+        auto& flat = assembly.at<FlatArray<CountedInt>>("flat");
+        CHECK(CountedInt::alive == 7);
+        CHECK(flat.size() == 5);
+        CHECK(&flat.element(3) == &assembly.at<CountedInt>(Address("flat", 3)));
+        CHECK(&flat.element(3) == flat.data() + 3);
+        int sum = 0;
+        for (auto it = flat.data(); it != flat.data() + 5; ++it) {
+            sum += it->get();
+        }
+        CHECK(sum == 15);
+        CHECK(assembly.at<IntInterface>(Address("flat2", "extra")).get() == 14);
+        CHECK(assembly.at<IntInterface>(Address("proxies", 1)).get() == 4);
+        CHECK(assembly.at<IntInterface>("reducer").get() == 15);
+
+        assembly.instantiate();
+        CHECK(CountedInt::alive == 7);
+        CHECK(assembly.at<FlatArray<CountedInt>>("flat").element(4).get() == 5);
+    }
+    CHECK(CountedInt::alive == 0);
+}
+
 /*
 =============================================================================================================================
   ~*~ ArraySet ~*~
@@ -87,6 +130,45 @@ TEST_CASE("Array connector error test.") {
     TINYCOMPO_TEST_ERRORS_END("Array connection: mismatched sizes. proxyArray has size 4 while intArray has size 5.");
 }
 
+struct OrderedReducer : public Component {  // records the values of its providers, in connection order
+    std::vector<int> values;
+    void add(IntInterface* ptr) { values.push_back(ptr->get()); }
+    OrderedReducer() { port("ptr", &OrderedReducer::add); }
+};
+
+TEST_CASE("Array connectors on arrays holding a subset of their elements") {
+    Model model;  // eg, the local shard of a distributed array
+    model.composite("ints");
+    model.composite("proxies");
+    model.composite("others");
+    for (int i : {10, 3, 1}) {
+        model.component<MyInt>(Address("ints", i), i);
+        model.component<MyIntProxy>(Address("proxies", i));
+    }
+    for (int i : {1, 2, 3}) {
+        model.component<MyIntProxy>(Address("others", i));
+    }
+    model.component<OrderedReducer>("reducer");
+    CHECK((model.get_composite("ints").all_indices() == std::vector<int>{1, 3, 10}));
+    Model dense;
+    for (int i : {2, 0, 1}) {
+        dense.component<MyInt>(i);
+    }
+    dense.component<MyInt>("not_an_index");
+    CHECK((dense.all_indices() == std::vector<int>{0, 1, 2}));
+    model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+    model.connect<MultiUse<IntInterface>>(PortAddress("ptr", "reducer"), Address("proxies"));
+    Assembly assembly(model);
+    CHECK(assembly.at<MyIntProxy>(Address("proxies", 10)).get() == 20);
+    CHECK((assembly.at<OrderedReducer>("reducer").values == std::vector<int>{2, 6, 20}));  // in index order
+
+    TINYCOMPO_TEST_ERRORS {
+        ArrayOneToOne<IntInterface>::_connect(assembly, PortAddress("ptr", "others"), Address("ints"));
+    }
+    TINYCOMPO_TEST_ERRORS_END(
+        "Array connection: mismatched elements. others and ints do not have the same element indices.");
+}
+
 /*
 =============================================================================================================================
   ~*~ Multiuse ~*~
@@ -124,3 +206,64 @@ TEST_CASE("MultiProvide connector tests.") {
     }
     TINYCOMPO_TEST_ERRORS_END("<MultiProvide::_connect> There was an error while trying to connect components.");
 }
+
+/*
+=============================================================================================================================
+  ~*~ Executor and ParallelMultiUse ~*~
+===========================================================================================================================*/
+TEST_CASE("Executor tests.") {
+    Executor executor(4);
+    CHECK(executor.nb_threads() == 4);
+
+    std::vector<std::atomic<int>> calls(1000);
+    for (int round = 0; round < 3; round++) {
+        executor.parallel_for(calls.size(), [&](std::size_t i) {
+            calls[i]++;
+            if (i % 7 == 0) {  // uneven calls to trigger stealing
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+    }
+    CHECK(std::all_of(calls.begin(), calls.end(), [](const std::atomic<int>& c) { return c == 3; }));
+
+    std::atomic<int> nested{0};
+    executor.parallel_for(8, [&](std::size_t) { executor.parallel_for(4, [&](std::size_t) { nested++; }); });
+    CHECK(nested == 32);
+
+    TINYCOMPO_TEST_ERRORS {
+        executor.parallel_for(100, [](std::size_t i) {
+            if (i == 42) {
+                throw TinycompoException("error in call 42");
+            }
+        });
+    }
+    TINYCOMPO_TEST_ERRORS_END("error in call 42");
+}
+
+struct ParallelUser : public Component {
+    ParallelGroup<IntInterface> group;
+    ParallelUser() { port("group", &ParallelUser::set_group); }
+    void set_group(ParallelGroup<IntInterface> g) { group = g; }
+    int sum() const {
+        std::atomic<int> result{0};
+        group.for_each([&](IntInterface* ptr) { result += ptr->get(); });
+        return result;
+    }
+};
+
+TEST_CASE("ParallelMultiUse tests.") {
+    Model model;
+    model.component<Executor>("executor", 3);
+    model.component<Array<MyInt>>("intArray", 50, 2);
+    model.component<ParallelUser>("user");
+    model.connect<ParallelMultiUse<IntInterface>>(PortAddress("group", "user"), Address("intArray"), Address("executor"));
+
+    Assembly assembly(model);
+    auto& user = assembly.at<ParallelUser>("user");
+    CHECK(user.group.size() == 50);
+    CHECK(user.group.executor() == &assembly.at<Executor>("executor"));
+    CHECK(user.group[3] == &assembly.at<IntInterface>(Address("intArray", 3)));
+    CHECK(user.sum() == 100);
+    CHECK(ParallelGroup<IntInterface>(std::vector<IntInterface*>(user.group.begin(), user.group.end()), nullptr).size() ==
+          50);
+}
@@ -105,6 +105,72 @@ TEST_CASE("Component get errors") {
     TINYCOMPO_TEST_ERRORS_END("<Component::get> Port name p3 not found. Existing ports are:\n  * p1\n  * p2\n");
     TINYCOMPO_TEST_MORE_ERRORS { compo.get<int>("p3"); }
     TINYCOMPO_TEST_ERRORS_END("<Component::get<Interface>> Port name p3 not found. Existing ports are:\n  * p1\n  * p2\n");
+    TINYCOMPO_TEST_MORE_ERRORS { compo.get("p1"); }
+    TINYCOMPO_TEST_ERRORS_END("<Component::get> Port p1 is not a provide port.");
+}
+
+struct MyStaticInt : public Component, public IntInterface {
+    int i{0};
+    int j{0};
+    MyInt wrapped{7};
+    IntInterface* ptr{nullptr};
+
+    static void declare_ports(PortTable<MyStaticInt>& t) {
+        t.port("set", &MyStaticInt::set_value);
+        t.port("j", &MyStaticInt::j);
+        t.port("ptr", &MyStaticInt::ptr);
+        t.provide("wrapped", &MyStaticInt::provide_wrapped);
+    }
+
+    explicit MyStaticInt(int i = 0) : i(i) { use_port_table<MyStaticInt>(); }
+    void set_value(int i2) { i = i2; }
+    IntInterface* provide_wrapped() { return &wrapped; }
+    int get() const override { return i + j + (ptr != nullptr ? ptr->get() : 0); }
+    std::string debug() const override { return "MyStaticInt"; }
+};
+
+struct MyDerivedStaticInt : public MyStaticInt {
+    static void declare_ports(PortTable<MyDerivedStaticInt>& t) {
+        t.port("set", &MyStaticInt::set_value);  // port from base class
+        t.port("double", &MyDerivedStaticInt::set_double);
+    }
+    MyDerivedStaticInt() { use_port_table<MyDerivedStaticInt>(); }
+    void set_double(int v) { i = 2 * v; }
+};
+
+TEST_CASE("Static port tables") {
+    MyStaticInt compo(3);
+    compo.set("set", 5);
+    compo.set("j", 2);
+    CHECK(compo.get() == 7);
+    Component& ref = compo;  // IntInterface::get hides Component::get
+    CHECK(ref.get<IntInterface>("wrapped")->get() == 7);
+    CHECK(ref.get("wrapped") == &compo.wrapped);
+    CHECK(&PortTable<MyStaticInt>::get() == &PortTable<MyStaticInt>::get());  // built once
+
+    TINYCOMPO_TEST_ERRORS { compo.set("set", true); }
+    TINYCOMPO_TEST_ERRORS_END("Setting property failed. Type tc::_Port<bool const> does not seem to match port set.");
+    TINYCOMPO_TEST_MORE_ERRORS { compo.set("badPort", 1); }
+    TINYCOMPO_TEST_ERRORS_END("Port name not found. Could not find port badPort in component MyStaticInt.");
+    TINYCOMPO_TEST_MORE_ERRORS { ref.get("p3"); }
+    TINYCOMPO_TEST_ERRORS_END(
+        "<Component::get> Port name p3 not found. Existing ports are:\n  * j\n  * ptr\n  * set\n  * wrapped\n");
+    TINYCOMPO_TEST_MORE_ERRORS { ref.get("set"); }
+    TINYCOMPO_TEST_ERRORS_END("<Component::get> Port set is not a provide port.");
+
+    MyDerivedStaticInt derived;
+    derived.set("double", 4);
+    CHECK(derived.get() == 8);
+    derived.set("set", 4);
+    CHECK(derived.get() == 4);
+
+    Model model;
+    model.component<MyStaticInt>("a", 1).set("j", 10);
+    model.component<MyStaticInt>("b", 2).connect<Use<IntInterface>>("ptr", "a");
+    model.component<MyIntProxy>("c").connect<UseProvide<IntInterface>>("ptr", PortAddress("wrapped", "b"));
+    Assembly assembly(model);
+    CHECK(assembly.at<IntInterface>("b").get() == 13);
+    CHECK(assembly.at<IntInterface>("c").get() == 14);
 }
 
 /*
@@ -220,6 +286,68 @@ TEST_CASE("Address: is_ancestor") {
     CHECK(not abc.is_ancestor(abd));
 }
 
+TEST_CASE("Address: interned keys, hash and order") {
+    Address abc("a", "b", "c");
+    Address abc2("a__b__c");
+    Address abd("a", "b", "d");
+    CHECK(abc.hash() == abc2.hash());
+    CHECK(abc.size() == 3);
+    CHECK(abc.key(1) == "b");
+
+    std::vector<Address> sorted{Address("b"), Address("a", "z"), abd, Address("a"), abc, Address("ab")};
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::string> names, expected{"a", "a__b__c", "a__b__d", "a__z", "ab", "b"};
+    for (auto& a : sorted) {
+        names.push_back(a.to_string());
+    }
+    CHECK(names == expected);
+
+    Address deep("k", 1, 2, 3, 4, 5, 6, 7, 8);  // deeper than inline storage
+    CHECK(deep.rest().rest().first() == "2");
+    CHECK(Address("k", 1, 2).is_ancestor(deep));
+    CHECK(deep.rebase(Address("k", 1, 2, 3, 4, 5, 6)) == Address(7, 8));
+    CHECK(Address(deep.to_string()) == deep);
+
+    std::unordered_set<Address> set{abc, abc2, abd, deep};
+    CHECK(set.size() == 3);
+    CHECK(set.count(Address("a", "b", "d")) == 1);
+}
+
+TEST_CASE("Address: key table") {
+    auto& table = _KeyTable::instance();
+    Address array("key_table_array");
+    auto stored = table.size();
+    bool same = true;
+    for (int i = 0; i < 10000; i++) {  // index keys are not stored
+        same = same and Address(array, i) == Address("key_table_array__" + std::to_string(i));
+    }
+    CHECK(same);
+    CHECK(table.size() == stored);
+    CHECK(Address(12, 34).index(1) == 34);
+    CHECK(Address("007").index(0) == -1);
+    CHECK(Address(1000000000) == Address("1000000000"));  // too large to be an index: stored
+    CHECK(Address(-3).key(0) == "-3");
+
+    stored = table.size();
+    std::vector<std::vector<Address>> interned(4);  // same keys from several threads, over several storage segments
+    std::vector<std::thread> threads;
+    for (auto& addresses : interned) {
+        threads.emplace_back([&addresses]() {
+            for (int i = 0; i < 10000; i++) {
+                addresses.emplace_back("key_table_" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(table.size() == stored + 10000);
+    for (auto& addresses : interned) {
+        CHECK(addresses == interned.front());
+    }
+    CHECK(interned.back()[9999].key(0) == "key_table_9999");
+}
+
 TEST_CASE("Address: rebase") {
     Address ab("a", "b");
     Address abcd("a", "b", "c", "d");
@@ -245,7 +373,8 @@ TEST_CASE("Address: error for keyrs with __") {
 
 TEST_CASE("Address::c_str") {
     Address a("a", "b", "c");
-    CHECK(strcmp(a.c_str(), "a__b__c") == 0);
+    CHECK(a.c_str() == "a__b__c");
+    CHECK(strcmp(a.c_str().c_str(), "a__b__c") == 0);
 }
 
 TEST_CASE("Address, first and last") {
@@ -423,6 +552,79 @@ TEST_CASE("Model test: digraph export") {
            multimap<string, string>{make_pair("a", "c"), make_pair("b", "c"), make_pair("c", "d"), make_pair("c", "e")}));
 }
 
+TEST_CASE("Model test: graph index") {
+    Model model;  // e uses c and d, which both use a (diamond); f uses e; b is alone
+    for (auto name : {"a", "b", "c", "d", "e", "f"}) {
+        model.component<IntReducer>(name);
+    }
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "e"), Address("c"));
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "c"), Address("a"));
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "e"), Address("d"));
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "d"), Address("a"));
+    model.connect<Set<int>>(PortAddress("set", "b"), 3);  // not an edge
+
+    auto& graph = model.graph();
+    CHECK((graph.nodes() == vector<string>{"e", "c", "a", "d", "b", "f"}));  // b and f are isolated
+    CHECK(graph.nb_edges() == 4);
+    CHECK(graph.contains("b"));
+    CHECK(graph.isolated(graph.id("b")));
+    CHECK(!graph.isolated(graph.id("a")));
+    CHECK(graph.ancestors("b").empty());
+    CHECK(graph.descendants("b").empty());
+    CHECK((model.get_digraph().first == set<string>{"a", "c", "d", "e"}));
+    CHECK((vector<size_t>(graph.providers(graph.id("e")).begin(), graph.providers(graph.id("e")).end()) ==
+           vector<size_t>{graph.id("c"), graph.id("d")}));
+    CHECK(graph.users(graph.id("a")).size() == 2);
+    CHECK((graph.topological_sort() == vector<string>{"a", "b", "f", "c", "d", "e"}));
+
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "f"), Address("e"));  // picked up by the next query
+    CHECK(&model.graph() == &graph);
+    CHECK((graph.nodes() == vector<string>{"e", "c", "a", "d", "b", "f"}));  // f keeps its id
+    CHECK((graph.topological_sort() == vector<string>{"a", "b", "c", "d", "e", "f"}));
+    CHECK((graph.ancestors("e") == vector<string>{"c", "d", "a"}));
+    CHECK((graph.descendants("a") == vector<string>{"c", "d", "e", "f"}));
+    CHECK((graph.nearest_users("a", [](const string& n) { return n != "c" and n != "d"; }) == vector<string>{"e"}));
+    CHECK((graph.nearest_providers("f", [](const string& n) { return n == "c" or n == "a"; }) == vector<string>{"c", "a"}));
+    CHECK((model.get_digraph().second.count("e") == 2));
+
+    Model copy = model;
+    copy.connect<Use<IntInterface>>(PortAddress("ptr", "a"), Address("f"));
+    CHECK(model.graph().nb_edges() == 5);
+    TINYCOMPO_TEST_ERRORS { copy.graph().topological_sort(); }
+    TINYCOMPO_TEST_ERRORS_END(
+        "<ModelGraph::topological_order> Graph has cycles. Nodes on or after a cycle:\n  * e\n  * c\n  * a\n  * d\n  * f\n");
+    TINYCOMPO_TEST_MORE_ERRORS { graph.id("g"); }
+    TINYCOMPO_TEST_ERRORS_END("<ModelGraph::id> Node g does not exist");
+}
+
+TEST_CASE("Model test: graph index with alternating declarations and queries") {
+    Model model;
+    model.component<IntReducer>("sink");
+    model.composite("array");
+    CHECK((model.graph().nodes() == vector<string>{"sink", "array"}));  // both isolated, in declaration order
+    for (int i = 0; i < 5; i++) {
+        model.component<IntReducer>(Address("array", i));
+        model.connect<Use<IntInterface>>(PortAddress("ptr", "sink"), Address("array", i));
+        auto& graph = model.graph();
+        CHECK(graph.nb_edges() == static_cast<size_t>(i) + 1);
+        CHECK(graph.size() == static_cast<size_t>(i) + 2);  // array is replaced by its elements
+        CHECK(!graph.contains("array"));
+        CHECK(graph.providers(graph.id("sink")).size() == static_cast<size_t>(i) + 1);
+        CHECK(graph.users(graph.id("array__" + std::to_string(i))).size() == 1);
+    }
+    model.component<IntReducer>("late");
+    model.connect<Use<IntInterface>>(PortAddress("ptr", "late"), Address("sink"));
+    auto& graph = model.graph();
+    CHECK((graph.nodes() == vector<string>{"sink", "array__0", "array__1", "array__2", "array__3", "array__4", "late"}));
+    CHECK((graph.topological_sort() ==
+           vector<string>{"array__0", "array__1", "array__2", "array__3", "array__4", "sink", "late"}));
+    CHECK((graph.ancestors("late") == vector<string>{"sink", "array__0", "array__1", "array__2", "array__3", "array__4"}));
+
+    Model copy = model;  // same ids as the original
+    CHECK((copy.graph().nodes() == graph.nodes()));
+    CHECK(copy.graph().id("late") == graph.id("late"));
+}
+
 TEST_CASE("_AssemblyGraph test: all_component_names") {
     Model model;
     model.component<MyInt>(0, 17);
@@ -478,6 +680,44 @@ TEST_CASE("Model test: has_type") {
     CHECK(model.has_type<MyIntProxy>("b") == false);
     CHECK(model.has_type<MyInt>(Address("b", "c")) == false);
     CHECK(model.has_type<MyIntProxy>(Address("b", "c")) == true);
+    CHECK(model.has_type<IntInterface>("a") == true);  // base classes, through cached probes
+    CHECK(model.has_type<IntInterface>("a") == true);
+    CHECK(model.has_type<Component>(Address("b", "c")) == true);
+    CHECK(model.has_type<IntReducer>(Address("b", "c")) == false);
+    TINYCOMPO_TEST_ERRORS { model.has_type<MyInt>("d"); }
+    TINYCOMPO_TEST_ERRORS_END("<Model::has_type> Component d does not exist. Existing components are:\n  * a\n");
+
+    struct NotConstructible : public MyInt {  // has_type should not construct components
+        NotConstructible() { throw TinycompoException("NotConstructible was constructed"); }
+    };
+    model.component<NotConstructible>("n");
+    CHECK(model.has_type<IntInterface>("n") == true);
+    CHECK(model.has_type<MyIntProxy>("n") == false);
+}
+
+struct Declared : public MyInt {
+    using interfaces = Interfaces<IntInterface>;
+};
+
+TEST_CASE("Model test: has_type with declared interfaces") {
+    struct Undeclared : public MyInt {};
+    Model model;
+    model.component<Declared>("d");
+    model.component<Undeclared>("u");
+
+    auto probes = _cast_probe_count();
+    CHECK(model.has_type<IntInterface>("d") == true);  // answered from the cast table recorded at declaration
+    CHECK(model.has_type<Declared>("d") == true);
+    CHECK(model.has_type<Component>("d") == true);
+    CHECK(model.has_type<Assembly>("d") == false);
+    CHECK(model.has_type<Assembly>("u") == false);
+    CHECK(_cast_probe_count() == probes);
+
+    CHECK(model.has_type<IntInterface>("u") == true);  // not declared: probed once (per thread)
+    CHECK(model.has_type<IntInterface>("u") == true);
+    CHECK(model.has_type<MyIntProxy>("u") == false);
+    CHECK(model.has_type<MyInt>("d") == true);
+    CHECK(_cast_probe_count() == probes + 3);
 }
 
 TEST_CASE("Model test: exists") {
@@ -505,6 +745,89 @@ TEST_CASE("Model test: all_addresses") {
     CHECK(model.all_addresses("b") == expected_result2);
 }
 
+struct CopyCounter {  // counts copies of the operation holding it, ie deep copies of the model containing it
+    static int copies;
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter&) { copies++; }
+};
+int CopyCounter::copies = 0;
+
+struct CountedConnect {
+    static void _connect(Assembly&, Address, const CopyCounter&) {}
+};
+
+TEST_CASE("Model test: copies of sub-models") {
+    Model model;
+    model.composite("l1");
+    model.composite(Address("l1", "l2"));
+    model.composite(Address("l1", "l2", "l3"));
+    model.component<MyInt>(Address("l1", "l2", "l3", "a"), 3);
+    model.get_composite(Address("l1", "l2", "l3")).connect<CountedConnect>(Address("a"), CopyCounter());
+    auto copies = CopyCounter::copies;
+
+    Introspector i(model);
+    CHECK(i.deep_nb_operations() == 1);
+    CHECK(i.deep_components().size() == 1);
+    CHECK(i.deep_directed_binops().empty());
+    CHECK(CopyCounter::copies == copies);
+
+    Model copy = model;  // sub-models are copied, but connector arguments are shared
+    CHECK(CopyCounter::copies == copies);
+    copy.component<MyInt>(Address("l1", "l2", "l3", "b"), 4);
+    CHECK(model.exists(Address("l1", "l2", "l3", "b")) == false);
+    CHECK(copy.exists(Address("l1", "l2", "l3", "b")) == true);
+
+    Assembly assembly(std::move(copy));
+    CHECK(CopyCounter::copies == copies);
+    CHECK(assembly.at<MyInt>(Address("l1", "l2", "l3", "b")).get() == 4);
+}
+
+TEST_CASE("Model test: nested composites are built without copying sub-models") {
+    int depth = 50;
+    Model model;
+    Address address("l0");
+    model.composite(address);
+    for (int i = 1; i < depth; i++) {
+        address = Address(address, "l" + std::to_string(i));
+        model.composite(address);
+    }
+    model.component<MyInt>(Address(address, "a"), 3);
+
+    auto copies = _model_copy_count();
+    Assembly assembly(model);  // one deep copy of the model, sub-assemblies share its sub-models
+    CHECK(_model_copy_count() - copies == static_cast<std::size_t>(depth) + 1);
+    CHECK(assembly.at<MyInt>(Address(address, "a")).get() == 3);
+    CHECK(&assembly.at<Assembly>("l0").get_model() == &assembly.get_model().get_composite("l0"));
+
+    copies = _model_copy_count();
+    Model model2 = model;
+    model2.component<MyInt>(Address(address, "b"), 4);
+    CHECK(_model_copy_count() - copies == static_cast<std::size_t>(depth) + 1);
+    assembly.update(model2);
+    CHECK(_model_copy_count() - copies == 2 * static_cast<std::size_t>(depth) + 2);
+    CHECK(assembly.at<MyInt>(Address(address, "b")).get() == 4);
+
+    copies = _model_copy_count();
+    Assembly assembly2(std::move(model2));
+    CHECK(_model_copy_count() == copies);
+}
+
+TEST_CASE("Model test: references to sub-models are not shared with copies") {
+    Model model;
+    model.composite("box");
+    model.component<MyInt>(Address("box", "x"), 1);
+    auto& box = model.get_composite("box");
+    Model snapshot = model;
+    box.component<MyInt>("y", 2);
+    CHECK(model.exists(Address("box", "y")) == true);
+    CHECK(snapshot.exists(Address("box", "y")) == false);
+
+    snapshot = model;
+    box.component<MyInt>("z", 3);
+    CHECK(snapshot.exists(Address("box", "y")) == true);
+    CHECK(snapshot.exists(Address("box", "z")) == false);
+}
+
 /*
 =============================================================================================================================
   ~*~ Meta things ~*~
@@ -545,6 +868,74 @@ TEST_CASE("Meta components") {
     CHECK(assembly.at<IntInterface>(Address("a", "b")).get() == 17);
 }
 
+/*
+=============================================================================================================================
+  ~*~ Snapshot ~*~
+===========================================================================================================================*/
+TEST_CASE("Snapshot: save and load") {
+    Snapshot::register_component<MyInt, int>("MyInt");
+    Snapshot::register_component<MyIntProxy>("MyIntProxy");
+    Snapshot::register_component<IntReducer>("IntReducer");
+    Snapshot::register_component<Composite>("Composite");
+    Snapshot::register_component<Array<MyInt>>("Array<MyInt>");
+    Snapshot::register_component<Array<MyIntProxy>>("Array<MyIntProxy>");
+    Snapshot::register_connector<Use<IntInterface>, PortAddress, Address>("Use<IntInterface>");
+    Snapshot::register_connector<MultiUse<IntInterface>, PortAddress, Address>("MultiUse<IntInterface>");
+    Snapshot::register_connector<ArrayOneToOne<IntInterface>, PortAddress, Address>("ArrayOneToOne<IntInterface>");
+    Snapshot::register_connector<Set<int>, PortAddress, int>("Set<int>");
+    Snapshot::register_connector<ArraySet<int>, PortAddress, std::vector<int>>("ArraySet<int>");
+
+    Model model;
+    model.component<Array<MyInt>>("ints", 4, 3);
+    model.component<Array<MyIntProxy>>("proxies", 4);
+    model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+    model.connect<ArraySet<int>>(PortAddress("set", "ints"), std::vector<int>{1, 2, 3, 4});
+    model.component<IntReducer>("reducer");
+    model.connect<UseOrArrayUse<IntInterface>>(PortAddress("ptr", "reducer"), Address("proxies"));  // expanded
+    model.composite("box");
+    model.component<MyInt>(Address("box", "c"), 5);
+    model.component<MyIntProxy>(Address("box", "p")).connect<Use<IntInterface>>("ptr", Address("box", "c"));
+    model.connect<Set<int>>(PortAddress("set", "box", "c"), 7);
+
+    std::stringstream snapshot;
+    Snapshot::save(model, snapshot);
+    Model loaded = Snapshot::load(snapshot);
+
+    std::stringstream dot, loaded_dot;
+    model.to_dot(0, "", dot);
+    loaded.to_dot(0, "", loaded_dot);
+    CHECK(dot.str() == loaded_dot.str());
+
+    Assembly assembly(loaded);
+    CHECK(assembly.at<IntInterface>("reducer").get() == 20);
+    CHECK(assembly.at<IntInterface>(Address("box", "p")).get() == 14);
+
+    model.configure("reducer", [](IntReducer&) {});
+    TINYCOMPO_TEST_ERRORS { Snapshot::save(model, snapshot); }
+    TINYCOMPO_TEST_ERRORS_END(
+        "<Snapshot::save> Operation of type lambda has no stored arguments (eg, configure) and cannot be saved");
+    Model model2;
+    model2.component<MyInt>("a");  // no constructor argument
+    TINYCOMPO_TEST_MORE_ERRORS { Snapshot::save(model2, snapshot); }
+    TINYCOMPO_TEST_ERRORS_END("<Snapshot::save> Component a has unregistered type tc::_Builder<MyInt>");
+    std::stringstream garbage("not a snapshot");
+    TINYCOMPO_TEST_MORE_ERRORS { Snapshot::load(garbage); }
+    TINYCOMPO_TEST_ERRORS_END("<Snapshot::load> Not a tinycompo snapshot");
+    std::stringstream complete;
+    Snapshot::save(loaded, complete);
+    std::stringstream truncated(complete.str().substr(0, complete.str().size() / 2));
+    TINYCOMPO_TEST_MORE_ERRORS { Snapshot::load(truncated); }
+    TINYCOMPO_TEST_ERRORS_END("<Snapshot::load> Unexpected end of snapshot");
+    std::stringstream corrupted;
+    write_state(corrupted, std::uint64_t(1) << 60);  // string size far beyond the data, must not be allocated
+    corrupted << "abc";
+    std::string corrupted_string;
+    TINYCOMPO_TEST_MORE_ERRORS { read_state(corrupted, corrupted_string); }
+    TINYCOMPO_TEST_ERRORS_END("<read_state> Unexpected end of state");
+    TINYCOMPO_TEST_MORE_ERRORS { Snapshot::register_component<MyIntProxy>("MyInt"); }
+    TINYCOMPO_TEST_ERRORS_END("<Snapshot::register> Type tc::_Builder<MyIntProxy> is already registered as MyIntProxy");
+}
+
 /*
 =============================================================================================================================
   ~*~ Assembly ~*~
@@ -791,6 +1182,482 @@ TEST_CASE("Assembly: get_all in composites") {
     CHECK(result3 == expected3);
 }
 
+TEST_CASE("Assembly: integer keys and handles") {
+    Model m;
+    m.component<Array<MyInt>>("array", 12, 4);
+    m.component<MyInt>(3, 33);
+    m.component<MyInt>("03", 303);  // not an array index
+    m.composite(Address("deep"));
+    m.composite(Address("deep", 0));
+    m.component<MyIntProxy>(Address("deep", 0, 1)).connect<Use<IntInterface>>("ptr", Address("array", 11));
+
+    Assembly a(m);
+    CHECK(a.at<MyInt>(3).get() == 33);
+    CHECK(a.at<MyInt>("03").get() == 303);
+    CHECK(&a.at<Assembly>("array").at<MyInt>(11) == &a.at<MyInt>(Address("array", 11)));
+    TINYCOMPO_TEST_ERRORS { a.at<Assembly>("array").at(12); }
+    TINYCOMPO_TEST_ERRORS_END(
+        "<Assembly::at> Trying to access incorrect address. Address 12 does not exist. Existing addresses are:\n  * 0\n  * "
+        "1\n  * 10\n  * 11\n  * 2\n  * 3\n  * 4\n  * 5\n  * 6\n  * 7\n  * 8\n  * 9\n");
+
+    auto h = a.handle<IntInterface>(Address("deep", 0, 1));
+    CHECK(h.valid());
+    CHECK(h->get() == 8);
+    a.at<MyInt>(Address("array", 11)).set(5);
+    CHECK((*h).get() == 10);
+    a.instantiate();
+    CHECK(not h.valid());
+    CHECK(a.handle(Address("deep", 0, 1)).get() == &a.at(Address("deep", 0, 1)));
+
+    // handles are checked against the assembly that owns the instance
+    auto deep = a.handle<IntInterface>(Address("deep", 0, 1));
+    auto top = a.handle<MyInt>("03");
+    a.at<Assembly>(Address("deep", 0)).instantiate();
+    CHECK(not deep.valid());
+    CHECK(top.valid());
+
+    // and remain safe to check once the assembly is gone
+    InstanceHandle<MyInt> dangling;
+    CHECK(not dangling.valid());
+    {
+        Assembly b(m);
+        dangling = b.handle<MyInt>(3);
+        CHECK(dangling.valid());
+    }
+    CHECK(not dangling.valid());
+}
+
+struct NoNeighborConnect {
+    static int count;
+    static void _connect(Assembly&) { count++; }
+};
+int NoNeighborConnect::count = 0;
+
+struct Serial {  // identifies instances (addresses of destroyed instances might be reused)
+    static int next;
+    int serial{next++};
+    virtual ~Serial() = default;
+};
+int Serial::next = 0;
+
+struct SerialInt : public MyInt, public Serial {
+    explicit SerialInt(int i = 0) : MyInt(i) {}
+};
+struct SerialProxy : public MyIntProxy, public Serial {};
+struct SerialReducer : public IntReducer, public Serial {};
+
+void declare_update_model(Model& m, int a_value, int array_size, bool connect_d) {
+    m.component<SerialInt>("a", a_value);
+    m.component<SerialProxy>("b").connect<Use<IntInterface>>("ptr", "a");
+    m.component<SerialInt>("c", 5);
+    m.component<SerialProxy>("d");
+    if (connect_d) {
+        m.connect<Use<IntInterface>>(PortAddress("ptr", "d"), "c");
+    }
+    m.component<Array<SerialInt>>("array", array_size, 1);
+    m.component<SerialReducer>("reducer").connect<MultiUse<IntInterface>>("ptr", Address("array"));
+}
+
+TEST_CASE("Assembly: incremental update") {
+    Model m;
+    declare_update_model(m, 3, 3, true);
+    Assembly a(m);
+    auto serials = [&a]() {  // serial of every instance
+        std::map<std::string, int> result;
+        for (auto& address : a.get_model().all_addresses()) {
+            result[address.to_string()] = a.at<Serial>(address).serial;
+        }
+        return result;
+    };
+    auto before = serials();
+    auto handle = a.handle<SerialInt>("c");
+
+    SUBCASE("unchanged model declared anew") {
+        Model m2;
+        declare_update_model(m2, 3, 3, true);
+        a.update(m2);
+        CHECK(serials() == before);
+        CHECK(handle.valid());
+    }
+
+    SUBCASE("changed constructor argument") {
+        Model m2;
+        declare_update_model(m2, 10, 3, true);
+        a.update(m2);
+        auto after = serials();
+        CHECK(after["a"] != before["a"]);
+        CHECK(after["b"] != before["b"]);  // user of a, connection replayed on a new instance
+        after.erase("a");
+        after.erase("b");
+        before.erase("a");
+        before.erase("b");
+        CHECK(after == before);
+        CHECK(a.at<IntInterface>("b").get() == 20);
+        CHECK(!handle.valid());
+    }
+
+    SUBCASE("added array element") {
+        Model m2;
+        declare_update_model(m2, 3, 4, true);
+        a.update(m2);
+        auto after = serials();
+        CHECK(after.size() == before.size() + 1);
+        CHECK(after["array__0"] == before["array__0"]);
+        CHECK(after["array__2"] == before["array__2"]);
+        CHECK(after["reducer"] != before["reducer"]);
+        CHECK(a.at<IntInterface>("reducer").get() == 4);
+        CHECK(a.at<Assembly>("array").size() == 4);
+        CHECK(a.at<Assembly>("array").get_model().size() == 4);
+    }
+
+    SUBCASE("added and removed operations") {
+        Model m2;
+        declare_update_model(m2, 3, 3, false);
+        a.update(m2);
+        CHECK(serials()["d"] != before["d"]);
+        CHECK(serials()["c"] == before["c"]);
+
+        Model m3 = a.get_model();
+        m3.component<SerialProxy>("e").connect<Use<IntInterface>>("ptr", Address("array", 1));
+        a.update(m3);
+        auto after = serials();
+        CHECK(after["array__1"] == before["array__1"]);
+        CHECK(after["b"] == before["b"]);
+        CHECK(a.at<IntInterface>("e").get() == 2);
+        CHECK(a.at<IntInterface>("reducer").get() == 3);
+    }
+
+    SUBCASE("errors and fallback") {
+        TINYCOMPO_TEST_ERRORS { a.update(a.get_model()); }
+        TINYCOMPO_TEST_ERRORS_END("<Assembly::update> Trying to update an assembly from its own model (use a copy)");
+
+        Model m2;
+        declare_update_model(m2, 3, 3, true);
+        m2.connect<NoNeighborConnect>();  // effects cannot be tracked: everything is rebuilt
+        a.update(m2);
+        CHECK(NoNeighborConnect::count == 1);
+        CHECK(serials()["c"] != before["c"]);
+        CHECK(a.at<IntInterface>("b").get() == 6);
+    }
+}
+
+struct ArenaCounted : public MyInt {
+    static int alive;
+    explicit ArenaCounted(int i = 0) : MyInt(i) { alive++; }
+    ~ArenaCounted() { alive--; }
+};
+int ArenaCounted::alive = 0;
+
+TEST_CASE("Assembly: arena allocation") {
+    Model m;
+    m.component<ArenaCounted>("a", 1);
+    m.component<ArenaCounted>("b", 2);
+    m.component<MyIntProxy>("c").connect<Use<IntInterface>>("ptr", "b");
+    m.component<Array<ArenaCounted>>("array", 10, 3);
+    m.component<FlatArray<ArenaCounted>>("flat", 4, 5);
+    m.component<IntReducer>("r").connect<MultiUse<IntInterface>>("ptr", Address("array"));
+
+    {
+        Assembly a;
+        a.use_arena();
+        a.set_build_threads(2);
+        a.instantiate_from(m);
+        CHECK(ArenaCounted::alive == 16);
+        CHECK(a.at<IntInterface>("c").get() == 4);
+        CHECK(a.at<IntInterface>("r").get() == 30);
+        for (int i = 0; i < 4; i++) {
+            CHECK(&a.at<FlatArray<ArenaCounted>>("flat").element(i) == &a.at<ArenaCounted>(Address("flat", i)));
+        }
+
+        a.instantiate();
+        CHECK(ArenaCounted::alive == 16);
+        CHECK(a.at<IntInterface>("r").get() == 30);
+
+        TINYCOMPO_TEST_ERRORS { a.use_arena(); }
+        TINYCOMPO_TEST_ERRORS_END("Trying to change the instance storage of an instantiated assembly");
+    }
+    CHECK(ArenaCounted::alive == 0);
+}
+
+TEST_CASE("Assembly: update of composites with a storage") {
+    auto declare = [](Model& m, int size) {
+        m.component<FlatArray<ArenaCounted>>("flat", size, 5);
+        m.component<IntReducer>("r").connect<MultiUse<IntInterface>>("ptr", Address("flat"));
+    };
+    {
+        Model m;
+        declare(m, 4);
+        Assembly a(m);
+        Model m2;
+        declare(m2, 8);
+        a.update(m2);
+        auto& flat = a.at<FlatArray<ArenaCounted>>("flat");
+        for (int i = 0; i < 8; i++) {
+            CHECK(&flat.element(i) == &a.at<ArenaCounted>(Address("flat", i)));
+        }
+        CHECK(ArenaCounted::alive == 8);
+        CHECK(a.at<IntInterface>("r").get() == 40);
+
+        Model m3;
+        declare(m3, 2);
+        a.update(m3);
+        CHECK(&a.at<FlatArray<ArenaCounted>>("flat").element(1) == &a.at<ArenaCounted>(Address("flat", 1)));
+        CHECK(ArenaCounted::alive == 2);
+        CHECK(a.at<IntInterface>("r").get() == 10);
+    }
+    CHECK(ArenaCounted::alive == 0);
+}
+
+TEST_CASE("Assembly: parallel build") {
+    struct ThrowingCompo : public Component {
+        ThrowingCompo() { throw TinycompoException("constructor failed"); }
+    };
+
+    auto declare = [](Model& m) {
+        m.component<Array<MyInt>>("array", 50, 3);
+        m.component<Array<MyIntProxy>>("proxies", 50);
+        m.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("array"));
+        m.component<IntReducer>("reducer").connect<MultiUse<IntInterface>>("ptr", Address("proxies"));
+        m.composite("box");
+        m.composite(Address("box", "p"));
+        for (int i = 0; i < 20; i++) {
+            m.component<MyInt>(Address("box", i), i).configure([](MyInt& r) { r.set(r.get() + 1); });
+            m.component<MyIntProxy>(Address("box", "p", i)).connect<Use<IntInterface>>("ptr", Address("box", i));
+        }
+        m.component<MyInt>("c", 2).set("set", 5).configure([](MyInt& r) { r.set(r.get() * 10); });
+    };
+
+    Model m, m2;
+    declare(m);
+    declare(m2);
+    Assembly serial(m);
+    Assembly parallel(m2, "", 4);
+    CHECK(parallel.at<IntInterface>("reducer").get() == serial.at<IntInterface>("reducer").get());
+    CHECK(parallel.at<IntInterface>("reducer").get() == 300);
+    CHECK(parallel.at<MyInt>("c").get() == 50);
+    for (int i = 0; i < 20; i++) {
+        CHECK(parallel.at<IntInterface>(Address("box", "p", i)).get() == 2 * (i + 1));
+    }
+    CHECK(parallel.at(Address("array", 7)).get_name() == "array__7");
+
+    Model m3;
+    m3.component<Array<MyInt>>("array", 10);
+    m3.component<ThrowingCompo>("bad");
+    Assembly a;
+    a.set_build_threads(3);
+    TINYCOMPO_TEST_ERRORS { a.instantiate_from(m3); }
+    TINYCOMPO_TEST_ERRORS_END("constructor failed");
+}
+
+TEST_CASE("Assembly: frozen assembly and concurrent lookups") {
+    Model m;
+    m.component<Array<MyInt>>("array", 20, 3);
+    m.component<IntReducer>("reducer").connect<MultiUse<IntInterface>>("ptr", Address("array"));
+    m.composite("box");
+    m.component<MyInt>(Address("box", "c"), 4);
+    m.component<MyIntProxy>(Address("box", "p")).connect<Use<IntInterface>>("ptr", Address("box", "c"));
+
+    Assembly assembly(m);
+    assembly.freeze();
+    CHECK(assembly.is_frozen());
+    CHECK(assembly.at<Assembly>("box").is_frozen());
+    CHECK(assembly.get_all<IntInterface>().pointers().size() == 23);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> errors{0};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 200; i++) {
+                Address address("array", (i + t) % 20);
+                errors += assembly.at<MyInt>(address).get() != 3;
+                errors += address.c_str() != address.to_string();
+                errors += assembly.at<IntInterface>(Address("box", "p")).get() != 8;
+                errors += assembly.at<IntInterface>("reducer").get() != 60;
+                errors += assembly.get_all<MyInt>(Address("box")).pointers().size() != 1;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(errors == 0);
+
+    TINYCOMPO_TEST_ERRORS { assembly.instantiate(); }
+    TINYCOMPO_TEST_ERRORS_END("<Assembly::instantiate> Trying to modify a frozen assembly");
+    TINYCOMPO_TEST_MORE_ERRORS { assembly.at<Assembly>("box").instantiate_from(Model()); }
+    TINYCOMPO_TEST_ERRORS_END("<Assembly::instantiate_from> Trying to modify a frozen assembly");
+    TINYCOMPO_TEST_MORE_ERRORS { assembly.at(Address("box", "d")); }
+    TINYCOMPO_TEST_ERRORS_END(
+        "<Assembly::at> Trying to access incorrect address. Address d does not exist. Existing addresses are:\n"
+        "  * c\n  * p\n");
+
+    assembly.unfreeze();
+    CHECK(!assembly.at<Assembly>("box").is_frozen());
+    assembly.instantiate();
+    CHECK(assembly.at<IntInterface>("reducer").get() == 60);
+}
+
+TEST_CASE("Assembly: lazy instantiation") {
+    Model m;
+    m.component<MyInt>("a", 3);
+    m.component<MyIntProxy>("p").connect<Use<IntInterface>>("ptr", "a");
+    m.component<ArenaCounted>("lone", 2);
+    m.component<Array<ArenaCounted>>("big", 100, 1);
+    m.component<Array<MyInt>>("ints", 5, 4);
+    m.component<IntReducer>("r").connect<MultiUse<IntInterface>>("ptr", Address("ints"));
+
+    {
+        Assembly a;
+        a.use_lazy_instantiation();
+        a.instantiate_from(m);
+        CHECK(a.size() == 6);
+        CHECK(!a.is_built("a"));
+        CHECK(a.at<IntInterface>("p").get() == 6);  // builds a too since p uses it
+        CHECK(a.is_built("a"));
+        CHECK(!a.is_built("r"));
+        CHECK(!a.is_built("lone"));
+        CHECK(ArenaCounted::alive == 0);
+
+        CHECK(a.at<MyInt>(Address("big", 7)).get() == 1);
+        CHECK(ArenaCounted::alive == 1);  // only one element of the (lazy) array
+        CHECK(a.at<Assembly>("big").size() == 100);
+        CHECK(a.at<IntInterface>("r").get() == 20);
+        CHECK(a.at<Assembly>("ints").is_built("3"));
+
+        TINYCOMPO_TEST_ERRORS { a.at("x"); }
+        TINYCOMPO_TEST_ERRORS_END(
+            "<Assembly::at> Trying to access incorrect address. Address x does not exist. Existing addresses are:\n  * "
+            "a\n  * lone\n  * p\n  * r\n  * big\n  * ints\n");
+
+        a.freeze();  // builds everything
+        CHECK(ArenaCounted::alive == 101);
+        CHECK(a.get_all<IntInterface>().pointers().size() == 109);
+    }
+    CHECK(ArenaCounted::alive == 0);
+
+    int count = NoNeighborConnect::count;
+    m.connect<NoNeighborConnect>();  // effects cannot be tracked: everything is built
+    Assembly a;
+    a.use_lazy_instantiation();
+    a.instantiate_from(m);
+    CHECK(a.is_built("lone"));
+    CHECK(NoNeighborConnect::count == count + 1);
+    CHECK(ArenaCounted::alive == 1);  // the big array has its own model which is still built lazily
+}
+
+struct Chain : public Component, public Checkpointable {
+    double x{0};
+    std::vector<int> history;
+    std::string label;
+    void save_state(std::ostream& os) const override {
+        write_state(os, x);
+        write_state(os, history);
+        write_state(os, label);
+    }
+    void load_state(std::istream& is) override {
+        read_state(is, x);
+        read_state(is, history);
+        read_state(is, label);
+    }
+};
+
+TEST_CASE("Assembly: checkpoint and restore") {
+    Model m;
+    m.component<Array<Chain>>("chains", 20);
+    m.component<MyInt>("not_saved", 3);
+    m.composite("box");
+    m.component<Chain>(Address("box", "c"));
+
+    std::stringstream checkpoint;
+    {
+        Assembly a(m, "", 4);
+        for (int i = 0; i < 20; i++) {
+            auto& chain = a.at<Chain>(Address("chains", i));
+            chain.x = 0.5 * i;
+            chain.history.assign(i, i);
+            chain.label = "chain" + std::to_string(i);
+        }
+        a.at<Chain>(Address("box", "c")).label = "boxed";
+        a.checkpoint(checkpoint);
+    }
+
+    Assembly a(m, "", 4);
+    a.restore(checkpoint);
+    for (int i = 0; i < 20; i++) {
+        auto& chain = a.at<Chain>(Address("chains", i));
+        CHECK(chain.x == 0.5 * i);
+        CHECK(chain.history == std::vector<int>(i, i));
+        CHECK(chain.label == "chain" + std::to_string(i));
+    }
+    CHECK(a.at<Chain>(Address("box", "c")).label == "boxed");
+
+    m.component<Chain>("extra");
+    Assembly other(m);
+    checkpoint.seekg(0);
+    TINYCOMPO_TEST_ERRORS { other.restore(checkpoint); }
+    TINYCOMPO_TEST_ERRORS_END("<Assembly::restore> Component extra has no state in checkpoint");
+    std::stringstream garbage("garbage");
+    TINYCOMPO_TEST_MORE_ERRORS { other.restore(garbage); }
+    TINYCOMPO_TEST_ERRORS_END("<Assembly::restore> Not a tinycompo checkpoint");
+    std::stringstream truncated(checkpoint.str().substr(0, checkpoint.str().size() - 10));
+    TINYCOMPO_TEST_MORE_ERRORS { a.restore(truncated); }
+    TINYCOMPO_THERE_WAS_AN_ERROR;
+    CHECK(error_message.find("<Assembly::restore> Checkpoint is truncated or corrupted") == 0);
+}
+
+TEST_CASE("Assembly: build report") {
+    Model m;
+    m.component<Array<MyInt>>("array", 3, 2);
+    m.component<IntReducer>("reducer").connect<MultiUse<IntInterface>>("ptr", Address("array"));
+    m.component<MyInt>("c", 1).configure([](MyInt& r) { r.set(3); });
+
+    BuildReport report;
+    Assembly a;
+    a.set_build_report(&report);
+    a.instantiate_from(m);
+
+    auto events = report.events();
+    auto count = [&](const std::string& kind) {
+        return std::count_if(events.begin(), events.end(), [&](const BuildReport::Event& e) { return e.kind == kind; });
+    };
+    CHECK(count("construct") == 6);  // the array and its 3 elements, the reducer and c
+    CHECK(count("after_construct") == 6);
+    CHECK(count("after_connect") == 6);
+    CHECK(count("connect") == 2);
+    auto reducer = std::find_if(events.begin(), events.end(), [](const BuildReport::Event& e) {
+        return e.kind == "construct" and e.name == "reducer";
+    });
+    REQUIRE(reducer != events.end());
+    CHECK(reducer->detail == "IntReducer");
+#ifdef TINYCOMPO_COUNT_ALLOCATIONS
+    CHECK(reducer->allocations > 0);  // its ports at least
+#else
+    CHECK(reducer->allocations == -1);
+#endif
+    auto connect = std::find_if(events.begin(), events.end(), [](const BuildReport::Event& e) {
+        return e.kind == "connect" and e.detail == "reducer.ptr array";
+    });
+    CHECK(connect != events.end());
+    CHECK(report.slowest(3).size() == 3);
+
+    std::stringstream trace;
+    auto flags = trace.flags();
+    report.to_chrome_trace(trace);
+    CHECK(trace.str().find("{\"traceEvents\":[\n{\"name\":") == 0);
+    auto ts = trace.str().find("\"ts\":") + 5;  // fixed notation, in microseconds with 3 decimals
+    auto ts_end = trace.str().find(",", ts);
+    CHECK(trace.str().substr(ts, ts_end - ts).find_first_not_of("0123456789.") == std::string::npos);
+    CHECK(trace.str()[ts_end - 4] == '.');
+    CHECK(trace.flags() == flags);
+    CHECK(trace.precision() == 6);
+    CHECK(trace.str().find("\"cat\":\"connect\"") != std::string::npos);
+
+    report.clear();
+    a.set_build_report(nullptr);
+    a.instantiate();
+    CHECK(report.events().empty());
+}
+
 /*
 =============================================================================================================================
   ~*~ Composite ~*~
@@ -885,6 +1752,30 @@ TEST_CASE("Use + Assembly: connection test") {
     CHECK(assembly.at<MyIntProxy>("Compo2").get() == 8);
 }
 
+template <class PtrClass>
+struct StaticProxy : public Component {
+    PtrClass* ptr{nullptr};
+    void setPtr(PtrClass* ptrin) { ptr = ptrin; }
+    int get() const { return ptr->get() * 2; }
+    StaticProxy() { port("ptr", &StaticProxy::setPtr); }
+};
+
+TEST_CASE("StaticUse test.") {
+    Model model;
+    model.component<Sealed<MyInt>>("Compo1", 4);
+    model.component<StaticProxy<Sealed<MyInt>>>("Compo2").connect<StaticUse<MyInt>>("ptr", "Compo1");
+    Assembly assembly(model);
+    CHECK(assembly.at<StaticProxy<Sealed<MyInt>>>("Compo2").ptr == &assembly.at<MyInt>("Compo1"));
+    CHECK(assembly.at<StaticProxy<Sealed<MyInt>>>("Compo2").get() == 8);
+    assembly.call("Compo1", "set", 5);  // ports of the provider are inherited
+    CHECK(assembly.at<StaticProxy<Sealed<MyInt>>>("Compo2").get() == 10);
+
+    model.component<MyInt>("Compo3", 3);
+    model.component<StaticProxy<Sealed<MyInt>>>("Compo4").connect<StaticUse<MyInt>>("ptr", "Compo3");
+    TINYCOMPO_TEST_ERRORS { Assembly assembly2(model); }
+    TINYCOMPO_TEST_ERRORS_END("<StaticUse::_connect> Component Compo3 is not declared as Sealed<MyInt>.");
+}
+
 TEST_CASE("UseProvide test.") {
     struct GetInt {
         virtual int getInt() = 0;
@@ -911,6 +1802,42 @@ TEST_CASE("UseProvide test.") {
     CHECK(assembly.at<User>("user").ptr->getInt() == 2);
 }
 
+TEST_CASE("UseTopoSort and UseNeighborhood tests.") {
+    struct Node : public Component {  // not an IntInterface
+        Node() { port("use", &Node::use); }
+        void use(Component*) {}
+    };
+    struct IntNode : public Node, public IntInterface {
+        int get() const override { return 1; }
+    };
+    struct Collector : public Component {
+        std::vector<IntInterface*> ptrs;
+        Collector() { port("ptr", &Collector::add); }
+        void add(IntInterface* ptr) { ptrs.push_back(ptr); }
+    };
+
+    Model model;
+    model.composite("gm");
+    auto& gm = model.get_composite("gm");
+    gm.component<IntNode>("a");
+    gm.component<Node>("r").connect<Use<Component>>("use", "a");
+    gm.component<IntNode>("b").connect<Use<Component>>("use", "r");
+    gm.component<IntNode>("c").connect<Use<Component>>("use", "a");
+    gm.component<Array<IntNode>>("arr", 2);
+    gm.connect<MultiProvide<Component>>(PortAddress("use", "arr"), Address("c"));
+    gm.component<IntNode>("z");  // isolated
+    model.component<Collector>("sorted").connect<UseTopoSort<IntInterface>>("ptr", Address("gm"));
+    model.component<Collector>("blanket").connect<UseNeighborhood<IntInterface>>("ptr", Address("gm"), "a");
+    model.component<Collector>("alone").connect<UseNeighborhood<IntInterface>>("ptr", Address("gm"), "z");
+
+    Assembly assembly(model);
+    auto at = [&](const Address& address) { return &assembly.at<IntInterface>(Address("gm", address)); };
+    CHECK((assembly.at<Collector>("sorted").ptrs ==
+           std::vector<IntInterface*>{at("a"), at("z"), at("c"), at("b"), at(Address("arr", 0)), at(Address("arr", 1))}));
+    CHECK((assembly.at<Collector>("blanket").ptrs == std::vector<IntInterface*>{at("c"), at("b")}));
+    CHECK(assembly.at<Collector>("alone").ptrs.empty());
+}
+
 TEST_CASE("Set test") {
     Model model;
     model.component<MyCompo>("compo", 2, 3);
@@ -932,6 +1859,56 @@ TEST_CASE("Attribute port declaration.") {
     CHECK(assembly.at<MyUltraBasicCompo>("compo").data == 14);
 }
 
+struct PortForwarder : public Component {  // calls a port of another component from one of its own ports
+    Component* target{nullptr};
+    PortForwarder() {
+        port("target", &PortForwarder::set_target);
+        port("value", &PortForwarder::forward);
+    }
+    void set_target(Component* c) { target = c; }
+    void forward(int value) { target->set("set", value); }
+};
+
+TEST_CASE("PortProfiler") {  // only records calls if TINYCOMPO_PROFILE_PORTS is defined (make test_bin TINYCOMPO_FLAGS=...)
+    Model model;
+    model.component<MyInt>("i", 3);
+    model.component<PortForwarder>("f");
+    Assembly assembly(model);
+    assembly.call("f", "target", static_cast<Component*>(&assembly.at<MyInt>("i")));
+
+    PortProfiler::reset();
+    for (int k = 0; k < 10; k++) {
+        assembly.call(PortAddress("value", "f"), k);
+    }
+    assembly.at("i").set("set", 2);
+    CHECK(assembly.at<MyInt>("i").i == 2);
+    std::stringstream folded, report;
+    PortProfiler::to_folded(folded);
+    PortProfiler::print(report);
+    if (not PortProfiler::enabled()) {
+        CHECK(PortProfiler::entries().empty());
+        CHECK(folded.str() == "");
+        return;
+    }
+
+    auto entries = PortProfiler::entries();
+    REQUIRE(entries.size() == 3);
+    CHECK((entries[0].path == std::vector<std::string>{"set:f.value"}));
+    CHECK(entries[0].count == 10);
+    CHECK((entries[1].path == std::vector<std::string>{"set:f.value", "set:i.set"}));
+    CHECK(entries[1].count == 10);
+    CHECK((entries[2].path == std::vector<std::string>{"set:i.set"}));
+    CHECK(entries[2].count == 1);
+    CHECK(entries[0].total_ns >= entries[0].framework_ns + entries[0].self_ns + entries[1].total_ns);
+    CHECK(folded.str().find("set:f.value;set:i.set;[tinycompo] ") != std::string::npos);
+    CHECK(report.str().find("set:i.set\t11 calls\t") != std::string::npos);
+
+    std::thread([&]() { assembly.call("i", "set", 4); }).join();  // calls of exited threads are kept
+    CHECK(PortProfiler::entries()[2].count == 2);
+    PortProfiler::reset();
+    CHECK(PortProfiler::entries().empty());
+}
+
 /*
 =============================================================================================================================
   ~*~ Drivers ~*~
@@ -0,0 +1,179 @@
+/* Copyright or © or Copr. Centre National de la Recherche Scientifique (CNRS) (2017/05/03)
+Contributors:
+- Vincent Lanore <vincent.lanore@gmail.com>
+
+This software is a computer program whose purpose is to provide the necessary classes to write ligntweight component-based
+c++ applications.
+
+This software is governed by the CeCILL-B license under French law and abiding by the rules of distribution of free software.
+You can use, modify and/ or redistribute the software under the terms of the CeCILL-B license as circulated by CEA, CNRS and
+INRIA at the following URL "http://www.cecill.info".
+
+As a counterpart to the access to the source code and rights to copy, modify and redistribute granted by the license, users
+are provided only with a limited warranty and the software's author, the holder of the economic rights, and the successive
+licensors have only limited liability.
+
+In this respect, the user's attention is drawn to the risks associated with loading, using, modifying and/or developing or
+reproducing the software by the user in light of its specific status of free software, that may mean that it is complicated
+to manipulate, and that also therefore means that it is reserved for developers and experienced professionals having in-depth
+computer knowledge. Users are therefore encouraged to load and test the software's suitability as regards their requirements
+in conditions enabling the security of their systems and/or data to be ensured and, more generally, to use and operate it in
+the same conditions as regards security.
+
+The fact that you are presently reading this means that you have had knowledge of the CeCILL-B license and that you accept
+its terms.*/
+
+#define DOCTEST_CONFIG_IMPLEMENT
+
+#include "test_utils.hpp"
+#include "tinycompo_mpi.hpp"
+
+using namespace std;
+using namespace tc;
+
+/*
+=============================================================================================================================
+  ~*~ Communicator membership ~*~
+===========================================================================================================================*/
+TEST_CASE("MPICommunicator: sub-communicators") {
+    auto core = MPIContext::core();
+    MPICommunicator odd(process::odd);
+    CHECK(odd.member() == (core.rank % 2 == 1));
+    if (odd.member()) {
+        CHECK(odd.rank() == core.rank / 2);
+        CHECK(odd.size() == core.size / 2);
+        auto ranks = odd.all_gather(core.rank);  // one value per member, not per process
+        CHECK(ranks.size() == static_cast<size_t>(core.size / 2));
+        CHECK(ranks[0] == 1);
+    } else {
+        CHECK(odd.rank() == -1);
+        int result;
+        TINYCOMPO_TEST_ERRORS { odd.allreduce(1, result); }
+        TINYCOMPO_TEST_ERRORS_END("<MPICommunicator::allreduce> Process " + to_string(core.rank) +
+                                  " is not a member of the communicator");
+    }
+}
+
+/*
+=============================================================================================================================
+  ~*~ Reductions ~*~
+===========================================================================================================================*/
+TEST_CASE("MPICommunicator: reductions") {
+    auto core = MPIContext::core();
+    MPICommunicator all(process::all);
+    int n = core.size;
+
+    double sum = 0;
+    all.allreduce(0.5 * core.rank, sum);
+    CHECK(sum == 0.25 * n * (n - 1));
+
+    vector<long> values{core.rank, 1}, result;
+    all.allreduce(values, result);
+    CHECK(result == (vector<long>{n * (n - 1) / 2, n}));
+    all.allreduce(values, MPI_MAX);  // in place
+    CHECK(values == (vector<long>{n - 1, 1}));
+
+    int max = -1;
+    all.reduce(core.rank, max, 0, MPI_MAX);
+    if (core.rank == 0) {
+        CHECK(max == n - 1);
+    } else {
+        CHECK(max == -1);
+    }
+
+    vector<int> partial{1, core.rank}, total;
+    all.reduce(partial, total, n - 1);
+    if (core.rank == n - 1) {
+        CHECK(total == (vector<int>{n, n * (n - 1) / 2}));
+    }
+
+    double nb_sum = 0;
+    vector<double> nb_values{1.0, 2.0}, nb_result;
+    vector<MPIRequest> requests;
+    requests.push_back(all.iallreduce(1.0, nb_sum));
+    requests.push_back(all.iallreduce(nb_values, nb_result));
+    int nb_max = -1;
+    requests.push_back(all.ireduce(core.rank, nb_max, 0, MPI_MAX));
+    wait_all(requests);
+    CHECK(nb_sum == n);
+    CHECK(nb_result == (vector<double>{1.0 * n, 2.0 * n}));
+    if (core.rank == 0) {
+        CHECK(nb_max == n - 1);
+    }
+}
+
+/*
+=============================================================================================================================
+  ~*~ Data movement ~*~
+===========================================================================================================================*/
+TEST_CASE("MPICommunicator: broadcast, scatter, gather and all-to-all") {
+    auto core = MPIContext::core();
+    MPICommunicator all(process::all);
+    int n = core.size;
+
+    int value = core.rank == 1 ? 42 : 0;
+    all.bcast(value, 1);
+    CHECK(value == 42);
+
+    vector<double> data;
+    if (core.rank == 0) {
+        data = {1.5, 2.5, 3.5};
+    }
+    all.bcast(data);
+    CHECK(data == (vector<double>{1.5, 2.5, 3.5}));
+
+    vector<int> fixed(2, core.rank);
+    auto request = all.ibcast(fixed, n - 1);
+    request.wait();
+    CHECK(fixed == (vector<int>{n - 1, n - 1}));
+
+    // member i gets i + 1 elements
+    vector<int> to_scatter, counts, scattered;
+    if (core.rank == 0) {
+        for (int i = 0; i < n; i++) {
+            counts.push_back(i + 1);
+            for (int j = 0; j <= i; j++) {
+                to_scatter.push_back(i);
+            }
+        }
+    }
+    all.scatterv(to_scatter, counts, scattered);
+    CHECK(scattered == vector<int>(core.rank + 1, core.rank));
+
+    vector<int> gathered;
+    all.gatherv(scattered, gathered);
+    if (core.rank == 0) {
+        CHECK(gathered == to_scatter);
+    } else {
+        CHECK(gathered.empty());
+    }
+
+    vector<int> all_ranks;
+    auto gather_request = all.iall_gather(core.rank, all_ranks);
+    gather_request.wait();
+    CHECK(all_ranks.size() == static_cast<size_t>(n));
+    CHECK(all_ranks[n - 1] == n - 1);
+
+    vector<int> to_send, received;  // block i contains 100 * rank + i
+    for (int i = 0; i < n; i++) {
+        to_send.push_back(100 * core.rank + i);
+        to_send.push_back(100 * core.rank + i);
+    }
+    all.alltoall(to_send, received);
+    CHECK(received.size() == static_cast<size_t>(2 * n));
+    CHECK(received[2 * (n - 1)] == 100 * (n - 1) + core.rank);
+
+    TINYCOMPO_TEST_ERRORS { all.alltoall(vector<int>(n + 1), received); }
+    TINYCOMPO_TEST_ERRORS_END("<MPICommunicator::alltoall> Data size " + to_string(n + 1) +
+                              " is not a multiple of communicator size " + to_string(n));
+}
+
+/*
+=============================================================================================================================
+  ~*~ main ~*~
+===========================================================================================================================*/
+int main(int argc, char** argv) {
+    MPIContext context(argc, argv);
+    doctest::Context doctest_context(argc, argv);
+    return doctest_context.run();
+}
@@ -0,0 +1,213 @@
+/* Copyright or © or Copr. Centre National de la Recherche Scientifique (CNRS) (2017/05/03)
+Contributors:
+- Vincent Lanore <vincent.lanore@gmail.com>
+
+This software is a computer program whose purpose is to provide the necessary classes to write ligntweight component-based
+c++ applications.
+
+This software is governed by the CeCILL-B license under French law and abiding by the rules of distribution of free software.
+You can use, modify and/ or redistribute the software under the terms of the CeCILL-B license as circulated by CEA, CNRS and
+INRIA at the following URL "http://www.cecill.info".
+
+As a counterpart to the access to the source code and rights to copy, modify and redistribute granted by the license, users
+are provided only with a limited warranty and the software's author, the holder of the economic rights, and the successive
+licensors have only limited liability.
+
+In this respect, the user's attention is drawn to the risks associated with loading, using, modifying and/or developing or
+reproducing the software by the user in light of its specific status of free software, that may mean that it is complicated
+to manipulate, and that also therefore means that it is reserved for developers and experienced professionals having in-depth
+computer knowledge. Users are therefore encouraged to load and test the software's suitability as regards their requirements
+in conditions enabling the security of their systems and/or data to be ensured and, more generally, to use and operate it in
+the same conditions as regards security.
+
+The fact that you are presently reading this means that you have had knowledge of the CeCILL-B license and that you accept
+its terms.*/
+
+#define DOCTEST_CONFIG_IMPLEMENT
+
+#include "test_utils.hpp"
+#include "tinycompo_mpi.hpp"
+
+using namespace std;
+using namespace tc;
+
+/*
+=============================================================================================================================
+  ~*~ Process sets ~*~
+===========================================================================================================================*/
+TEST_CASE("ProcessSet and RelativeProcess") {
+    auto core = MPIContext::core();
+    CHECK(process::odd.members(7) == (vector<int>{1, 3, 5}));
+    CHECK(process::up_from(2).members(4) == (vector<int>{2, 3}));
+    CHECK(process::interval(1, 3).contains(2));
+    CHECK(!process::interval(1, 3).contains(3));
+    CHECK(ProcessSet::strided(-3, 9, 4).members(100) == (vector<int>{1, 5}));
+    ProcessSet multiple_of_three([](int p) { return p % 3 == 0; });  // predicate fallback
+    CHECK(multiple_of_three.members(7) == (vector<int>{0, 3, 6}));
+    CHECK(ProcessSet().members(10).empty());
+
+    // closed-form inverses agree with the generic enumeration
+    RelativeProcess generic_next([](int p) { return p + 1; }), generic_zero([](int) { return 0; });
+    for (auto& set : {process::all, process::odd, process::zero, multiple_of_three}) {
+        CHECK(process::to_next.all_origins(set) == generic_next.all_origins(set));
+        CHECK(process::to_zero.all_origins(set) == generic_zero.all_origins(set));
+    }
+    auto origins = process::to_next.all_origins(process::all);
+    CHECK(origins == set<int>{(core.rank + core.size - 1) % core.size});
+    CHECK(process::to(core.size + 1).process_modifier(0) % core.size == 1);
+}
+
+/*
+=============================================================================================================================
+  ~*~ Partition ~*~
+===========================================================================================================================*/
+TEST_CASE("Partition: block and cyclic") {
+    Partition block, cyclic(Partition::cyclic);
+    CHECK(block.local_indices(0, 10, 4) == (vector<int>{0, 1, 2}));
+    CHECK(block.local_indices(1, 10, 4) == (vector<int>{3, 4, 5}));
+    CHECK(block.local_indices(3, 10, 4) == (vector<int>{8, 9}));
+    CHECK(block.local_indices(3, 2, 4).empty());
+    CHECK(cyclic.local_indices(1, 10, 4) == (vector<int>{1, 5, 9}));
+    for (int n : {2, 10, 13}) {
+        for (int i = 0; i < n; i++) {
+            for (auto partition : {block, cyclic}) {
+                auto local = partition.local_indices(partition.owner(i, n, 4), n, 4);
+                CHECK(find(local.begin(), local.end(), i) != local.end());
+            }
+        }
+    }
+}
+
+/*
+=============================================================================================================================
+  ~*~ Distributed arrays ~*~
+===========================================================================================================================*/
+TEST_CASE("DistributedArray and array connectors") {
+    auto core = MPIContext::core();
+    for (auto partition : {Partition(Partition::block), Partition(Partition::cyclic)}) {
+        MPIModel model;
+        model.component<DistributedArray<MyInt>>("ints", process::all, 10, partition, 3);
+        model.component<DistributedArray<MyIntProxy>>("proxies", process::all, 10, partition);
+        model.component<IntReducer>("reducer", process::all);
+        model.component<MyInt>("mapper", process::all, 1);
+        model.component<DistributedArray<MyIntProxy>>("mapped", process::all, 10, partition);
+        model.comm("comm", process::all);
+        model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+        model.connect<MultiUse<IntInterface>>(PortAddress("ptr", "reducer"), Address("proxies"));
+        model.connect<MultiProvide<IntInterface>>(PortAddress("ptr", "mapped"), Address("mapper"));
+        MPIAssembly assembly(model);
+
+        auto local = partition.local_indices(core.rank, 10, core.size);
+        CHECK(assembly.at<DistributedArray<MyInt>>("ints").indices() == local);
+        for (auto i : local) {
+            CHECK(assembly.at<IntInterface>(Address("proxies", i)).get() == 6);
+            CHECK(assembly.at<IntInterface>(Address("mapped", i)).get() == 2);
+        }
+
+        // each reducer sums its shard, shards are combined by a collective
+        int total = 0;
+        assembly.at<MPICommunicator>("comm").allreduce(assembly.at<IntInterface>("reducer").get(), total);
+        CHECK(assembly.at<IntInterface>("reducer").get() == 6 * static_cast<int>(local.size()));
+        CHECK(total == 60);
+    }
+}
+
+TEST_CASE("DistributedReduction") {
+    auto core = MPIContext::core();
+    auto get = [](IntInterface& i) { return i.get(); };
+    for (int size : {2, 10}) {  // with 2 elements, some processes have no local element
+        MPIModel model;
+        model.component<DistributedArray<MyInt>>("ints", process::all, size, Partition::cyclic, 3);
+        model.component<DistributedArray<MyIntProxy>>("proxies", process::all, size, Partition::cyclic);
+        model.component<DistributedReduction<IntInterface, int>>("sum", process::all, get);
+        model.component<DistributedReduction<IntInterface, double>>("max", process::all, &IntInterface::get, MPI_MAX,
+                                                                    -1.0);
+        model.comm("comm", process::all);
+        model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+        model.connect<MultiUse<IntInterface>>(PortAddress("ptr", "sum"), Address("proxies"));
+        model.connect<MultiUse<IntInterface>>(PortAddress("ptr", "max"), Address("ints"));
+        model.mpi_connect<UseComm>(PortAddress("comm", "sum"), process::all, Address("comm"));
+        model.mpi_connect<UseComm>(PortAddress("comm", "max"), process::all, Address("comm"));
+        MPIAssembly assembly(model);
+
+        auto& sum = assembly.at<DistributedReduction<IntInterface, int>>("sum");
+        auto local = Partition(Partition::cyclic).local_indices(core.rank, size, core.size);
+        CHECK(sum.local_size() == local.size());
+        CHECK(sum.get() == 6 * size);
+        double max = 0;
+        auto request = assembly.at<DistributedReduction<IntInterface, double>>("max").iget(max);
+        request.wait();
+        CHECK(max == 3.0);
+    }
+}
+
+TEST_CASE("Array connectors: mismatched partitions") {
+    auto core = MPIContext::core();
+    MPIModel model;
+    model.component<DistributedArray<MyInt>>("ints", process::all, 10, Partition::block);
+    model.component<DistributedArray<MyIntProxy>>("proxies", process::all, 10, Partition::cyclic);
+    model.connect<ArrayOneToOne<IntInterface>>(PortAddress("ptr", "proxies"), Address("ints"));
+    auto block = Partition(Partition::block).local_indices(core.rank, 10, core.size);
+    auto cyclic = Partition(Partition::cyclic).local_indices(core.rank, 10, core.size);
+    bool same = block == cyclic;
+    string expected = (block.size() != cyclic.size())
+                          ? "Array connection: mismatched sizes. proxies has size " + to_string(cyclic.size()) +
+                                " while ints has size " + to_string(block.size()) + "."
+                          : "Array connection: mismatched elements. proxies and ints do not have the same element indices.";
+    TINYCOMPO_TEST_ERRORS { MPIAssembly assembly(model); }
+    TINYCOMPO_TEST_ERRORS_END((same ? string("") : expected));
+}
+
+/*
+=============================================================================================================================
+  ~*~ Checkpoints ~*~
+===========================================================================================================================*/
+struct StateInt : public MyInt, public Checkpointable {
+    explicit StateInt(int i = 0) : MyInt(i) {}
+    void save_state(std::ostream& os) const override { write_state(os, i); }
+    void load_state(std::istream& is) override { read_state(is, i); }
+};
+
+TEST_CASE("MPIAssembly checkpoint and restore") {
+    auto core = MPIContext::core();
+    MPIModel model;
+    model.component<DistributedArray<StateInt>>("states", process::all, 10, Partition::block);
+    model.component<StateInt>("root_only", process::zero, 1);  // not on all processes
+    auto local = Partition(Partition::block).local_indices(core.rank, 10, core.size);
+
+    string prefix = "mpi_checkpoint_test";
+    {
+        MPIAssembly assembly(model);
+        for (auto i : local) {
+            assembly.at<StateInt>(Address("states", i)).i = 100 * core.rank + i;
+        }
+        assembly.checkpoint(prefix);
+    }
+    MPIAssembly restored(model);
+    restored.restore(prefix);
+    for (auto i : local) {
+        CHECK(restored.at<StateInt>(Address("states", i)).i == 100 * core.rank + i);
+    }
+    remove((prefix + "." + to_string(core.rank)).c_str());
+
+    // a process failing to restore does not leave the other ones waiting
+    restored.checkpoint(prefix);
+    if (core.rank == 0) {
+        remove((prefix + ".0").c_str());
+    }
+    string expected = "<MPIAssembly::restore> Failed on 1 process(es)";
+    expected += (core.rank == 0) ? ": <Assembly::restore> Could not open file " + prefix + ".0" : "";
+    TINYCOMPO_TEST_ERRORS { restored.restore(prefix); }
+    TINYCOMPO_TEST_ERRORS_END(expected);
+    remove((prefix + "." + to_string(core.rank)).c_str());
+}
+
+/*
+=============================================================================================================================
+  ~*~ main ~*~
+===========================================================================================================================*/
+int main(int argc, char** argv) {
+    MPIContext context(argc, argv);
+    doctest::Context doctest_context(argc, argv);
+    return doctest_context.run();
+}
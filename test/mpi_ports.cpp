@@ -0,0 +1,195 @@
+/* Copyright or © or Copr. Centre National de la Recherche Scientifique (CNRS) (2017/05/03)
+Contributors:
+- Vincent Lanore <vincent.lanore@gmail.com>
+
+This software is a computer program whose purpose is to provide the necessary classes to write ligntweight component-based
+c++ applications.
+
+This software is governed by the CeCILL-B license under French law and abiding by the rules of distribution of free software.
+You can use, modify and/ or redistribute the software under the terms of the CeCILL-B license as circulated by CEA, CNRS and
+INRIA at the following URL "http://www.cecill.info".
+
+As a counterpart to the access to the source code and rights to copy, modify and redistribute granted by the license, users
+are provided only with a limited warranty and the software's author, the holder of the economic rights, and the successive
+licensors have only limited liability.
+
+In this respect, the user's attention is drawn to the risks associated with loading, using, modifying and/or developing or
+reproducing the software by the user in light of its specific status of free software, that may mean that it is complicated
+to manipulate, and that also therefore means that it is reserved for developers and experienced professionals having in-depth
+computer knowledge. Users are therefore encouraged to load and test the software's suitability as regards their requirements
+in conditions enabling the security of their systems and/or data to be ensured and, more generally, to use and operate it in
+the same conditions as regards security.
+
+The fact that you are presently reading this means that you have had knowledge of the CeCILL-B license and that you accept
+its terms.*/
+
+#define DOCTEST_CONFIG_IMPLEMENT
+
+#include "test_utils.hpp"
+#include "tinycompo_mpi.hpp"
+
+using namespace std;
+using namespace tc;
+
+/*
+=============================================================================================================================
+  ~*~ Non-blocking operations ~*~
+===========================================================================================================================*/
+TEST_CASE("MPIPort: isend, irecv and wait_all") {
+    auto core = MPIContext::core();
+    int tag = MPIContext::get_tag();
+
+    if (core.rank == 0) {
+        vector<MPIPort> ports;
+        for (int p = 1; p < core.size; p++) {
+            ports.emplace_back(p, tag);
+        }
+        auto received = receive_all(ports);
+        for (int p = 1; p < core.size; p++) {
+            CHECK(received[p - 1] == 10 * p);
+        }
+    } else {
+        MPIPort port(0, tag);
+        auto request = port.isend(10 * core.rank);  // sent by copy: the request owns the data
+        request.wait();
+        CHECK(request.test());
+    }
+
+    // ring exchange: receptions are posted before sends to show overlap
+    int ring_tag = MPIContext::get_tag();
+    MPIPort next((core.rank + 1) % core.size, ring_tag), previous((core.rank + core.size - 1) % core.size, ring_tag);
+    int from_previous = -1;
+    vector<MPIRequest> requests;
+    requests.push_back(previous.irecv(from_previous));
+    requests.push_back(next.isend(core.rank));
+    wait_all(requests);
+    CHECK(from_previous == (core.rank + core.size - 1) % core.size);
+}
+
+/*
+=============================================================================================================================
+  ~*~ Coalescing ~*~
+===========================================================================================================================*/
+TEST_CASE("MPIPort: push, flush and receive_batch") {
+    auto core = MPIContext::core();
+    int tag = MPIContext::get_tag();
+
+    if (core.rank == 0) {
+        for (int p = 1; p < core.size; p++) {
+            MPIPort port(p, tag);
+            vector<int> first, second;
+            port.receive_batch(first);  // sent automatically when the batch was full
+            port.receive_batch(second);  // sent by flush
+            CHECK(first.size() == 256);
+            CHECK(second.size() == 44);
+            CHECK(first[0] == p);
+            CHECK(second[43] == p + 299);
+        }
+    } else {
+        MPIPort port(0, tag);
+        for (int i = 0; i < 300; i++) {
+            port.push(core.rank + i);
+        }
+        port.flush();
+        port.flush();  // nothing left to send
+    }
+}
+
+TEST_CASE("MPIPort: pending values follow the port") {
+    auto core = MPIContext::core();
+    int tag = MPIContext::get_tag();
+
+    if (core.rank == 0) {
+        for (int p = 1; p < core.size; p++) {
+            MPIPort port(p, tag);
+            vector<int> batch;
+            int single = -1;
+            port.receive_batch(batch);  // batches do not match regular messages on the same port
+            port.receive(single);
+            CHECK(batch.size() == 3);
+            CHECK(batch[2] == p + 2);
+            CHECK(single == 10 * p);
+        }
+    } else {
+        vector<MPIPort> ports;
+        ports.emplace_back(0, tag);
+        for (int i = 0; i < 3; i++) {
+            ports[0].push(core.rank + i);
+        }
+        TINYCOMPO_TEST_ERRORS { MPIPort copy(ports[0]); }
+        TINYCOMPO_TEST_ERRORS_END("<MPIPort::MPIPort> Trying to copy a port with 3 pushed values not flushed yet");
+        ports.emplace_back(0, tag);  // pending values are moved to the new buffer of the vector
+        ports[1].send(10 * core.rank);
+        ports.clear();  // flushed on destruction
+    }
+}
+
+/*
+=============================================================================================================================
+  ~*~ Typed payloads ~*~
+===========================================================================================================================*/
+struct Params {  // trivially copyable struct sent through a derived datatype
+    int id;
+    double value;
+    char flag;
+};
+
+TEST_CASE("MPIPort: typed send and receive") {
+    auto core = MPIContext::core();
+    int tag = MPIContext::get_tag();
+    CHECK(_MPIType<double>::get() == MPI_DOUBLE);
+    CHECK(_MPIType<Params>::get() == _MPIType<Params>::get());  // created once
+
+    if (core.rank == 0) {
+        for (int p = 1; p < core.size; p++) {
+            MPIPort port(p, tag);
+            vector<double> parameters(1000, -1);
+            auto storage = parameters.data();
+            port.receive(parameters);
+            CHECK(parameters.data() == storage);  // received in place
+            CHECK(parameters.size() == 1000);
+            CHECK(parameters[999] == p + 999 * 0.5);
+
+            vector<double> empty;
+            port.receive(empty);  // resized from the size of the message
+            CHECK(empty.size() == 3);
+
+            array<int, 3> triple;
+            port.receive(triple);
+            CHECK(triple[2] == 3 * p);
+
+            Params params;
+            port.receive(params);
+            CHECK(params.id == p);
+            CHECK(params.value == 0.25 * p);
+            CHECK(params.flag == 'x');
+
+            double scalar;
+            auto request = port.irecv(scalar);
+            request.wait();
+            CHECK(scalar == 1.5 * p);
+        }
+    } else {
+        MPIPort port(0, tag);
+        vector<double> parameters(1000);
+        for (int i = 0; i < 1000; i++) {
+            parameters[i] = core.rank + i * 0.5;
+        }
+        port.send(parameters);
+        port.send(vector<double>{1, 2, 3});
+        port.send(array<int, 3>{{core.rank, 2 * core.rank, 3 * core.rank}});
+        port.send(Params{core.rank, 0.25 * core.rank, 'x'});
+        auto request = port.isend(1.5 * core.rank);
+        request.wait();
+    }
+}
+
+/*
+=============================================================================================================================
+  ~*~ main ~*~
+===========================================================================================================================*/
+int main(int argc, char** argv) {
+    MPIContext context(argc, argv);
+    doctest::Context doctest_context(argc, argv);
+    return doctest_context.run();
+}
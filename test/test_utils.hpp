@@ -28,6 +28,7 @@ license and that you accept its terms.*/
 #ifndef TEST_UTILS
 #define TEST_UTILS
 
+#include <unordered_set>
 #include "../tinycompo.hpp"
 #include "doctest.h"
 
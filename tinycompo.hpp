@@ -31,18 +31,37 @@ its terms.*/
 #endif
 
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
 #include <exception>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -65,6 +84,18 @@ struct Meta {};  // type tag for meta connectors
 template <class T>  // this is an empty helper class that is used to pass T to the _ComponentBuilder
 class _Type {};     // constructor below
 
+// C++11 integer_sequence implementation :/ (used to expand tuples of stored arguments)
+template <int...>
+struct _seq {};
+
+template <int N, int... S>
+struct _gens : _gens<N - 1, N - 1, S...> {};
+
+template <int... S>
+struct _gens<0, S...> {
+    typedef _seq<S...> type;
+};
+
 struct _AbstractPort {
     virtual ~_AbstractPort() = default;
 };
@@ -110,10 +141,13 @@ class TinycompoDebug {  // bundle of static functions to help with debug message
 
   public:
     template <class T>
-    static std::string type() {  // display human-friendly typename
-        return demangle(typeid(T).name());
+    static std::string type() {  // display human-friendly typename (demangled once per type)
+        static const std::string name = demangle(typeid(T).name());
+        return name;
     }
 
+    static std::string type(const std::type_info& info) { return demangle(info.name()); }
+
     template <class T1, class T2>
     static std::string list(const std::map<T1, T2>& structure) {  // bullet-pointed list of key names in a string
         std::stringstream acc;
@@ -124,6 +158,50 @@ class TinycompoDebug {  // bundle of static functions to help with debug message
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ _parallel_for ~*~
+Calls f(0), ..., f(n-1) using up to nb_threads threads (the calling thread being one of them). Indices are distributed
+through an atomic counter so that threads which happen to get cheap calls pick up more of them. The first exception thrown by
+a call is rethrown in the calling thread once all threads are done. This is an internal helper used by the parallel build.
+===========================================================================================================================*/
+template <class F>
+void _parallel_for(std::size_t n, int nb_threads, F f) {
+    if (nb_threads <= 1 or n <= 1) {
+        for (std::size_t i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error{nullptr};
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < n; i = next++) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+                next = n;  // no point in starting new calls
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < std::min(n, static_cast<std::size_t>(nb_threads)); t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
 /*
 =============================================================================================================================
   ~*~ _Port class ~*~
@@ -158,6 +236,282 @@ struct _ProvidePort : public _AbstractProvidePort {
     _ProvidePort(Assembly& assembly, PortAddress port);  // composite port, provide
 };
 
+/*
+=============================================================================================================================
+  ~*~ Static ports ~*~
+Static ports are the per-class counterpart of _Port and _ProvidePort: they store a pointer to member instead of a functor
+bound to an instance, and receive the instance when called. They are stored in a _PortTable which is built once per component
+class (see PortTable below) and shared by all its instances.
+===========================================================================================================================*/
+template <class... Args>
+struct _StaticPort : public _AbstractPort {
+    virtual void _set(Component* ref, Args... args) const = 0;
+};
+
+template <class C, class... Args>
+struct _StaticMethodPort : public _StaticPort<const Args...> {
+    void (C::*prop)(Args...);
+    explicit _StaticMethodPort(void (C::*prop)(Args...)) : prop(prop) {}
+    void _set(Component* ref, const Args... args) const override {
+        (static_cast<C*>(ref)->*prop)(std::forward<const Args>(args)...);
+    }
+};
+
+template <class C, class Type>
+struct _StaticAttributePort : public _StaticPort<const Type> {
+    Type C::*prop;
+    explicit _StaticAttributePort(Type C::*prop) : prop(prop) {}
+    void _set(Component* ref, const Type arg) const override { static_cast<C*>(ref)->*prop = arg; }
+};
+
+struct _AbstractStaticProvidePort : public _AbstractPort {
+    virtual Component* get_type_erased(Component* ref) const = 0;
+};
+
+template <class Interface>
+struct _StaticProvidePort : public _AbstractStaticProvidePort {
+    virtual Interface* _get(Component* ref) const = 0;
+    Component* get_type_erased(Component* ref) const override { return dynamic_cast<Component*>(_get(ref)); }
+};
+
+template <class C, class Interface>
+struct _StaticGetterPort : public _StaticProvidePort<Interface> {
+    Interface* (C::*prop)();
+    explicit _StaticGetterPort(Interface* (C::*prop)()) : prop(prop) {}
+    Interface* _get(Component* ref) const override { return (static_cast<C*>(ref)->*prop)(); }
+};
+
+struct _PortTable {
+    std::map<std::string, std::unique_ptr<_AbstractPort>> ports;
+};
+
+/*
+=============================================================================================================================
+  ~*~ PortProfiler ~*~
+When TINYCOMPO_PROFILE_PORTS is defined before including tinycompo, every port call (Component::set, Assembly::call) and
+every provide port get is counted and timed. Calls are recorded as a call tree: a port called from inside another port call
+is a child of that call. Each frame is named kind:component.port, where component is the instance name given by the assembly.
+The time spent in tinycompo before reaching the port (component and port lookup, casts) is recorded separately from the time
+spent in the port itself. Each thread records its own calls, and PortProfiler merges them. Results can be printed per
+component and port, or exported as folded stacks (the input format of flamegraph.pl and speedscope): one
+"frame;...;frame nanoseconds" line per call path, with a [tinycompo] child frame holding the framework overhead. Without the
+flag nothing is recorded and ports have no overhead. The flag changes inline functions, so all translation units of a
+program must agree on it.
+===========================================================================================================================*/
+struct _PortProfileNode {
+    const Component* component;
+    const _AbstractPort* port;
+    std::string component_name, frame;
+    std::size_t parent;
+    std::int64_t count{0}, total_ns{0}, framework_ns{0}, children_ns{0};
+    std::map<std::pair<const Component*, const _AbstractPort*>, std::size_t> children;
+
+    _PortProfileNode(const Component* component, const _AbstractPort* port, const std::string& component_name,
+                     const std::string& frame, std::size_t parent)
+        : component(component), port(port), component_name(component_name), frame(frame), parent(parent) {}
+};
+
+class PortProfiler {
+  public:
+    struct Entry {
+        std::vector<std::string> path;  // frames from the outermost call to this one
+        std::int64_t count, total_ns, framework_ns;
+        std::int64_t self_ns;  // time spent in the port itself, excluding framework overhead and nested port calls
+    };
+
+  private:
+    friend class _PortCallTimer;
+
+    struct Table {  // calls made by one thread
+        std::mutex mutex;
+        std::vector<_PortProfileNode> nodes;  // nodes[0] is the root of the call tree
+        std::size_t current{0};
+
+        Table() {
+            nodes.push_back(_PortProfileNode{nullptr, nullptr, "", "", 0});
+            auto& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.tables.insert(this);
+        }
+
+        ~Table() {  // thread exit: keeps its calls
+            auto& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            collect(*this, r.retired);
+            r.tables.erase(this);
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::set<Table*> tables;
+        std::map<std::vector<std::string>, Entry> retired;  // calls of threads that have exited
+    };
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    static Table& table() {
+        static thread_local Table t;
+        return t;
+    }
+
+    static void collect(Table& t, std::map<std::vector<std::string>, Entry>& acc) {
+        std::lock_guard<std::mutex> lock(t.mutex);
+        std::vector<std::vector<std::string>> paths(t.nodes.size());  // parents are always created before children
+        for (std::size_t i = 1; i < t.nodes.size(); i++) {
+            auto& node = t.nodes[i];
+            paths[i] = paths[node.parent];
+            paths[i].push_back(node.frame);
+            if (node.count > 0) {
+                auto& entry = acc.emplace(paths[i], Entry{paths[i], 0, 0, 0, 0}).first->second;
+                entry.count += node.count;
+                entry.total_ns += node.total_ns;
+                entry.framework_ns += node.framework_ns;
+                entry.self_ns += std::max<std::int64_t>(0, node.total_ns - node.framework_ns - node.children_ns);
+            }
+        }
+    }
+
+    static std::size_t enter(const Component* component, const std::string& component_name, const _AbstractPort* port,
+                             const char* kind, const std::string& port_name) {
+        auto& t = table();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        auto key = std::make_pair(component, port);
+        auto it = t.nodes[t.current].children.find(key);
+        if (it == t.nodes[t.current].children.end() or t.nodes[it->second].component_name != component_name) {
+            // second case: another component now lives at the address of a deleted one
+            std::string frame = std::string(kind) + ":" + (component_name.empty() ? "(anonymous)" : component_name) + "." +
+                                port_name;
+            t.nodes.push_back(_PortProfileNode{component, port, component_name, frame, t.current});
+            it = t.nodes[t.current].children.insert(std::make_pair(key, t.nodes.size() - 1)).first;
+            it->second = t.nodes.size() - 1;
+        }
+        t.current = it->second;
+        return t.current;
+    }
+
+    static void exit(std::size_t node, std::int64_t framework_ns, std::int64_t port_ns) {
+        auto& t = table();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        auto& n = t.nodes[node];
+        n.count++;
+        n.total_ns += framework_ns + port_ns;
+        n.framework_ns += framework_ns;
+        t.nodes[n.parent].children_ns += framework_ns + port_ns;
+        t.current = n.parent;
+    }
+
+  public:
+    static bool enabled() {
+#ifdef TINYCOMPO_PROFILE_PORTS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static std::vector<Entry> entries() {  // merged over all threads, sorted by path
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto acc = r.retired;
+        for (auto t : r.tables) {
+            collect(*t, acc);
+        }
+        std::vector<Entry> result;
+        for (auto& e : acc) {
+            result.push_back(e.second);
+        }
+        return result;
+    }
+
+    static void reset() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.clear();
+        for (auto t : r.tables) {  // nodes are kept because calls might be in progress
+            std::lock_guard<std::mutex> table_lock(t->mutex);
+            for (auto& node : t->nodes) {
+                node.count = node.total_ns = node.framework_ns = node.children_ns = 0;
+            }
+        }
+    }
+
+    static void print(std::ostream& os = std::cout) {  // one line per component and port, slowest first
+        std::map<std::string, Entry> frames;
+        for (auto& e : entries()) {
+            auto& frame = frames.emplace(e.path.back(), Entry{{e.path.back()}, 0, 0, 0, 0}).first->second;
+            frame.count += e.count;
+            frame.total_ns += e.total_ns;
+            frame.framework_ns += e.framework_ns;
+            frame.self_ns += e.self_ns;
+        }
+        std::vector<Entry> sorted;
+        for (auto& f : frames) {
+            sorted.push_back(f.second);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) { return a.total_ns > b.total_ns; });
+        for (auto& e : sorted) {
+            os << e.path.back() << "\t" << e.count << " calls\t" << e.total_ns << " ns\t" << e.framework_ns
+               << " ns in tinycompo\n";
+        }
+    }
+
+    static void to_folded(std::ostream& os) {
+        for (auto& e : entries()) {
+            std::string path;
+            for (auto& frame : e.path) {
+                path += (path.empty() ? "" : ";") + frame;
+            }
+            if (e.self_ns > 0) {
+                os << path << " " << e.self_ns << "\n";
+            }
+            if (e.framework_ns > 0) {
+                os << path << ";[tinycompo] " << e.framework_ns << "\n";
+            }
+        }
+    }
+
+    static void to_folded(const std::string& file_name) {
+        std::ofstream os(file_name);
+        to_folded(os);
+    }
+};
+
+#ifdef TINYCOMPO_PROFILE_PORTS
+class _PortCallTimer {  // times one port call from its creation (before port lookup) to its destruction
+    using clock = std::chrono::steady_clock;
+    clock::time_point start{clock::now()}, port_start;
+    std::int64_t framework_ns{0};
+    std::size_t node{0};
+
+  public:
+    _PortCallTimer() = default;
+    _PortCallTimer(const _PortCallTimer&) = delete;
+
+    void enter(const Component* component, const std::string& component_name, const _AbstractPort* port, const char* kind,
+               const std::string& port_name) {  // called once the port is found, right before calling it
+        framework_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        node = PortProfiler::enter(component, component_name, port, kind, port_name);
+        port_start = clock::now();
+    }
+
+    ~_PortCallTimer() {
+        if (node != 0) {
+            auto port_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - port_start).count();
+            PortProfiler::exit(node, framework_ns, port_ns);
+        }
+    }
+};
+#else
+class _PortCallTimer {
+  public:
+    void enter(const Component*, const std::string&, const _AbstractPort*, const char*, const std::string&) {}
+};
+#endif
+
 /*
 =============================================================================================================================
   ~*~ Component class ~*~
@@ -166,10 +520,51 @@ class instances but also provides basic debugging methods and the infrastructure
 ===========================================================================================================================*/
 class Component {
     std::map<std::string, std::unique_ptr<_AbstractPort>> _ports;  // not meant to be accessible for users
+    const _PortTable* _port_table{nullptr};                        // static ports shared by all instances of a class
     std::string name{""};                                          // accessible through get/set name accessors
 
     friend Assembly;
 
+    _AbstractPort* find_port(const std::string& name) const {  // instance ports first, then static ports
+        auto it = _ports.find(name);
+        if (it != _ports.end()) {
+            return it->second.get();
+        }
+        if (_port_table != nullptr) {
+            auto static_it = _port_table->ports.find(name);
+            if (static_it != _port_table->ports.end()) {
+                return static_it->second.get();
+            }
+        }
+        return nullptr;
+    }
+
+    std::string port_list() const {
+        return TinycompoDebug::list(_ports) + ((_port_table != nullptr) ? TinycompoDebug::list(_port_table->ports) : "");
+    }
+
+    template <class... Args>
+    void set_port(_PortCallTimer& timer, const std::string& name, Args... args) {  // timer: see PortProfiler
+        auto port = find_port(name);
+        if (port == nullptr) {  // there exists no port with this name
+            throw TinycompoException{"Port name not found. Could not find port " + name + " in component " + debug() + "."};
+        }
+        auto ptr = dynamic_cast<_Port<const Args...>*>(port);
+        if (ptr != nullptr) {  // casting succeedeed
+            timer.enter(this, this->name, port, "set", name);
+            ptr->_set(std::forward<Args>(args)...);
+            return;
+        }
+        auto static_ptr = dynamic_cast<_StaticPort<const Args...>*>(port);
+        if (static_ptr != nullptr) {
+            timer.enter(this, this->name, port, "set", name);
+            static_ptr->_set(this, std::forward<Args>(args)...);
+        } else {  // casting failed, trying to provide useful error message
+            throw TinycompoException("Setting property failed. Type " + TinycompoDebug::type<_Port<const Args...>>() +
+                                     " does not seem to match port " + name + '.');
+        }
+    }
+
   public:
     /*
     =========================================================================================================================
@@ -212,49 +607,104 @@ class Component {
             static_cast<_AbstractPort*>(new _ProvidePort<Interface>(dynamic_cast<C*>(this), prop)));
     }
 
+    template <class C>  // uses the ports declared by C::declare_ports (see PortTable), to be called in C's constructor
+    void use_port_table();
+
     /*
     =========================================================================================================================
       ~*~ Accessors to ports and name ~*~  */
 
     template <class... Args>
-    void set(std::string name, Args... args) {    // no perfect forwarding to avoid references
-        if (_ports.find(name) == _ports.end()) {  // there exists no port with this name
-            throw TinycompoException{"Port name not found. Could not find port " + name + " in component " + debug() + "."};
-        } else {  // there exists a port with this name
-            auto ptr = dynamic_cast<_Port<const Args...>*>(_ports[name].get());
-            if (ptr != nullptr)  // casting succeedeed
-            {
-                ptr->_set(std::forward<Args>(args)...);
-            } else {  // casting failed, trying to provide useful error message
-                throw TinycompoException("Setting property failed. Type " + TinycompoDebug::type<_Port<const Args...>>() +
-                                         " does not seem to match port " + name + '.');
-            }
-        }
+    void set(std::string name, Args... args) {  // no perfect forwarding to avoid references
+        _PortCallTimer timer;
+        set_port<Args...>(timer, name, std::forward<Args>(args)...);
     }
 
     template <class Interface>
     Interface* get(std::string name) const {
-        try {
-            return dynamic_cast<_ProvidePort<Interface>*>(_ports.at(name).get())->_get();
-        } catch (std::out_of_range) {
+        _PortCallTimer timer;
+        auto port = find_port(name);
+        if (port == nullptr) {
             throw TinycompoException("<Component::get<Interface>> Port name " + name + " not found. Existing ports are:\n" +
-                                     TinycompoDebug::list(_ports));
+                                     port_list());
+        }
+        auto ptr = dynamic_cast<_ProvidePort<Interface>*>(port);
+        if (ptr != nullptr) {
+            timer.enter(this, this->name, port, "get", name);
+            return ptr->_get();
         }
+        auto static_ptr = dynamic_cast<_StaticProvidePort<Interface>*>(port);
+        if (static_ptr == nullptr) {
+            throw TinycompoException("<Component::get<Interface>> Port " + name + " does not provide interface " +
+                                     TinycompoDebug::type<Interface>() + '.');
+        }
+        timer.enter(this, this->name, port, "get", name);
+        return static_ptr->_get(const_cast<Component*>(this));
     }
 
     Component* get(std::string name) const {
-        try {
-            return dynamic_cast<_AbstractProvidePort*>(_ports.at(name).get())->get_type_erased();
-        } catch (std::out_of_range) {
+        _PortCallTimer timer;
+        auto port = find_port(name);
+        if (port == nullptr) {
             throw TinycompoException("<Component::get> Port name " + name + " not found. Existing ports are:\n" +
-                                     TinycompoDebug::list(_ports));
+                                     port_list());
         }
+        auto ptr = dynamic_cast<_AbstractProvidePort*>(port);
+        if (ptr != nullptr) {
+            timer.enter(this, this->name, port, "get", name);
+            return ptr->get_type_erased();
+        }
+        auto static_ptr = dynamic_cast<_AbstractStaticProvidePort*>(port);
+        if (static_ptr == nullptr) {
+            throw TinycompoException("<Component::get> Port " + name + " is not a provide port.");
+        }
+        timer.enter(this, this->name, port, "get", name);
+        return static_ptr->get_type_erased(const_cast<Component*>(this));
     }
 
     void set_name(const std::string& n) { name = n; }
     std::string get_name() const { return name; }
 };
 
+/*
+=============================================================================================================================
+  ~*~ PortTable ~*~
+Ports declared in constructors cost one map node and one heap-allocated functor per port and per instance. Alternatively, a
+component class C can describe its ports once, in a static function declare_ports(PortTable<C>&), and call
+use_port_table<C>() in its constructor. The table is then built on first use and shared by all instances of C. Both kinds of
+ports can be mixed; instance ports take precedence over static ones when names collide.
+===========================================================================================================================*/
+template <class C>
+class PortTable : public _PortTable {
+    PortTable() { C::declare_ports(*this); }
+
+  public:
+    static const PortTable<C>& get() {
+        static const PortTable<C> table;  // thread-safe initialization
+        return table;
+    }
+
+    template <class B, class... Args>  // case where the port is a setter member function (possibly from a base of C)
+    void port(const std::string& name, void (B::*prop)(Args...)) {
+        ports[name] = std::unique_ptr<_AbstractPort>(new _StaticMethodPort<C, Args...>(prop));
+    }
+
+    template <class B, class Arg>  // case where the port is a data member
+    void port(const std::string& name, Arg(B::*prop)) {
+        ports[name] = std::unique_ptr<_AbstractPort>(new _StaticAttributePort<C, Arg>(prop));
+    }
+
+    template <class B, class Interface>
+    void provide(const std::string& name, Interface* (B::*prop)()) {
+        ports[name] = std::unique_ptr<_AbstractPort>(new _StaticGetterPort<C, Interface>(prop));
+    }
+};
+
+template <class C>
+void Component::use_port_table() {
+    _port_table = &PortTable<C>::get();
+}
+
 /*
 =============================================================================================================================
   ~*~ key_to_string ~*~
@@ -266,27 +716,191 @@ std::string key_to_string(Key key) {
     return ss.str();
 }
 
+inline std::string key_to_string(const std::string& key) { return key; }  // common cases that need no stringstream
+
+inline std::string key_to_string(const char* key) { return key; }
+
+inline std::string key_to_string(int key) { return std::to_string(key); }
+
+/*
+=============================================================================================================================
+  ~*~ _KeyTable ~*~
+Global table interning address keys: each distinct key string is identified by an integer id. Keys that are array indices
+(see parse_index) are not stored at all: their id is the bitwise complement of the index, so arrays of any size add nothing
+to the table and resolving an index requires neither parsing nor a lookup. Other keys are stored once, for the whole
+program (so references returned by stored() stay valid); they are the names used in models, whose number does not grow with
+their size. Storage grows in segments of doubling size, which are never moved, and reading a key does not lock: an id can
+only be obtained from intern, so its entry is visible to any thread that got the id through proper synchronization.
+Interning locks only one of several shards, chosen by the hash of the key.
+===========================================================================================================================*/
+class _KeyTable {
+    enum { first_segment_bits = 12, nb_segments = 20, nb_shards = 16 };  // segments hold ids up to 2^31
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, int> ids;
+    };
+
+    Shard shards[nb_shards];
+    std::atomic<int> nb_keys{0};
+    std::atomic<std::string*> segments[nb_segments];
+
+    static std::size_t segment(int id) {  // segment 0 holds ids [0, 2^12), segment s > 0 holds ids [2^(11+s), 2^(12+s))
+        std::size_t result = 0;
+        for (auto n = static_cast<unsigned>(id) >> first_segment_bits; n != 0; n >>= 1) {
+            result++;
+        }
+        return result;
+    }
+
+    static std::size_t segment_begin(std::size_t s) { return (s == 0) ? 0 : std::size_t(1) << (first_segment_bits + s - 1); }
+
+    std::string& entry(int id) const {
+        auto s = segment(id);
+        return segments[s].load(std::memory_order_acquire)[id - segment_begin(s)];
+    }
+
+    int store(const std::string& key) {  // id of key in storage (whether it is an index or not)
+        auto& shard = shards[std::hash<std::string>()(key) % nb_shards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.ids.find(key);
+        if (it != shard.ids.end()) {
+            return it->second;
+        }
+        int id = nb_keys.fetch_add(1);
+        if (id < 0 or segment(id) >= nb_segments) {
+            throw TinycompoException("<_KeyTable::intern> Too many distinct address keys");
+        }
+        auto& segment_ptr = segments[segment(id)];
+        if (segment_ptr.load(std::memory_order_acquire) == nullptr) {  // segments are shared by all shards
+            auto new_segment = new std::string[segment_begin(segment(id) + 1) - segment_begin(segment(id))];
+            std::string* expected = nullptr;
+            if (!segment_ptr.compare_exchange_strong(expected, new_segment, std::memory_order_acq_rel)) {
+                delete[] new_segment;  // another shard allocated it first
+            }
+        }
+        entry(id) = key;
+        shard.ids.emplace(key, id);
+        return id;
+    }
+
+  public:
+    _KeyTable() {
+        for (auto& s : segments) {
+            s.store(nullptr);
+        }
+    }
+
+    ~_KeyTable() {
+        for (auto& s : segments) {
+            delete[] s.load();
+        }
+    }
+
+    static int parse_index(const std::string& key) {  // value of key if it is a canonical non-negative int, -1 otherwise
+        if (key.empty() or key.size() > 9 or (key[0] == '0' and key.size() > 1)) {
+            return -1;
+        }
+        int result = 0;
+        for (auto c : key) {
+            if (c < '0' or c > '9') {
+                return -1;
+            }
+            result = 10 * result + (c - '0');
+        }
+        return result;
+    }
+
+    static _KeyTable& instance() {
+        static _KeyTable table;
+        return table;
+    }
+
+    static int index_id(int index) { return ~index; }  // id of a non-negative index key (not stored)
+
+    int intern(const std::string& key) {
+        int index = parse_index(key);
+        return (index >= 0) ? index_id(index) : store(key);
+    }
+
+    const std::string& stored(const std::string& key) { return entry(store(key)); }  // valid for the whole program
+
+    std::string key(int id) const { return (id < 0) ? std::to_string(~id) : entry(id); }
+
+    static int index(int id) { return (id < 0) ? ~id : -1; }
+
+    std::size_t size() const { return nb_keys.load(); }  // number of stored keys
+};
+
+/*
+=============================================================================================================================
+  ~*~ _KeyVector ~*~
+Vector of key ids which stores up to inline_capacity ids without allocating (deeper addresses spill to the heap).
+===========================================================================================================================*/
+class _KeyVector {
+    enum { inline_capacity = 6 };
+    std::size_t _size{0};
+    int inline_ids[inline_capacity]{};
+    std::vector<int> heap_ids;
+
+  public:
+    std::size_t size() const { return _size; }
+    const int* begin() const { return (_size <= inline_capacity) ? inline_ids : heap_ids.data(); }
+    const int* end() const { return begin() + _size; }
+    int operator[](std::size_t i) const { return begin()[i]; }
+
+    void push_back(int id) {
+        if (_size < inline_capacity) {
+            inline_ids[_size] = id;
+        } else {
+            if (_size == inline_capacity) {
+                heap_ids.assign(inline_ids, inline_ids + inline_capacity);
+            }
+            heap_ids.push_back(id);
+        }
+        _size++;
+    }
+
+    bool operator==(const _KeyVector& other) const {
+        return _size == other._size and std::equal(begin(), end(), other.begin());
+    }
+};
+
 /*
 =============================================================================================================================
   ~*~ Addresses ~*~
+Addresses are sequences of interned keys (see _KeyTable) with a cached hash: copying short addresses does not allocate,
+equality is decided by comparing hashes then integers, and ordering only looks up strings for the first differing key (the
+order itself is the lexicographic order on key strings).
 ===========================================================================================================================*/
 class Address {
-    std::vector<std::string> keys;
-    mutable std::string to_string_buf{""};
+    _KeyVector keys;
+    std::size_t hash_value{0};
+
+    void push_key(int id) {
+        keys.push_back(id);
+        hash_value ^= std::hash<int>()(id) + 0x9e3779b9 + (hash_value << 6) + (hash_value >> 2);
+    }
 
     template <class Arg>
-    void register_helper(std::true_type, Arg arg) {
-        keys.insert(keys.end(), arg.keys.begin(), arg.keys.end());
+    void register_helper(std::true_type, const Arg& arg) {
+        for (auto id : arg.keys) {
+            push_key(id);
+        }
+    }
+
+    void register_helper(std::false_type, int arg) {  // index keys need no string (see _KeyTable::parse_index)
+        bool index = arg >= 0 and arg <= 999999999;
+        push_key(index ? _KeyTable::index_id(arg) : _KeyTable::instance().intern(std::to_string(arg)));
     }
 
     template <class Arg>
-    void register_helper(std::false_type, Arg arg) {
+    void register_helper(std::false_type, const Arg& arg) {
         auto strkey = key_to_string(arg);
         if (strkey.find("__") != std::string::npos) {
             throw TinycompoException("Trying to add key " + strkey + " (which contains __) of type " +
                                      TinycompoDebug::type<Arg>() + " to address " + to_string() + "\n");
         }
-        keys.push_back(strkey);
+        push_key(_KeyTable::instance().intern(strkey));
     }
 
     template <class Arg>
@@ -309,25 +923,21 @@ class Address {
     Address(double input) { register_keys(input); }
 
     Address(const std::string& input) {
-        std::string copy = input;
-        auto get_token = [&]() -> std::string {
-            auto it = copy.find("__");
-            std::string result;
-            if (it != std::string::npos) {
-                result = copy.substr(0, it);
-                copy = copy.substr(++++it);
-            } else {
-                result = copy;
-                copy = "";
-            }
-            return result;
-        };
-        std::string token = get_token();
-        keys.push_back(token);
+        auto& table = _KeyTable::instance();
+        std::size_t begin = 0;
         while (true) {
-            token = get_token();
-            if (token == "") break;
-            keys.push_back(token);
+            auto it = input.find("__", begin);
+            if (it == std::string::npos) {
+                if (begin == 0 or begin < input.size()) {  // first key is always registered, even if empty
+                    push_key(table.intern(input.substr(begin)));
+                }
+                break;
+            }
+            if (it == begin and begin != 0) {  // empty token after the first one: stop there
+                break;
+            }
+            push_key(table.intern(input.substr(begin, it - begin)));
+            begin = it + 2;
         }
     }
 
@@ -336,9 +946,15 @@ class Address {
         register_keys(key, std::forward<Keys>(keys)...);
     }
 
+    std::size_t size() const { return keys.size(); }  // number of keys
+
+    std::string key(std::size_t i) const { return _KeyTable::instance().key(keys[i]); }
+
+    int index(std::size_t i) const { return _KeyTable::index(keys[i]); }  // i-th key as array index (or -1)
+
     std::string first() const {
         if (keys.size() > 0) {
-            return keys.front();
+            return key(0);
         } else {
             return "";
         }
@@ -346,16 +962,24 @@ class Address {
 
     std::string last() const {
         if (keys.size() > 0) {
-            return keys.back();
+            return key(keys.size() - 1);
         } else {
             return "";
         }
     }
 
+    Address head() const {  // address made of the first key only
+        Address acc;
+        if (keys.size() > 0) {
+            acc.push_key(keys[0]);
+        }
+        return acc;
+    }
+
     Address rest() const {
         Address acc;
-        for (unsigned int i = 1; i < keys.size(); i++) {
-            acc.register_keys(keys.at(i));
+        for (std::size_t i = 1; i < keys.size(); i++) {
+            acc.push_key(keys[i]);
         }
         return acc;
     }
@@ -363,11 +987,7 @@ class Address {
     bool is_composite() const { return keys.size() > 1; }
 
     bool is_ancestor(const Address& other) const {
-        if (keys.size() == 0) {
-            return true;
-        } else {
-            return (first() == other.first()) and rest().is_ancestor(other.rest());
-        }
+        return keys.size() <= other.keys.size() and std::equal(keys.begin(), keys.end(), other.keys.begin());
     }
 
     Address rebase(const Address& other) const {  // if other is ancestor, remove corresponding prefix
@@ -375,11 +995,11 @@ class Address {
             throw TinycompoException("Trying to rebase address " + to_string() + " from " + other.to_string() +
                                      " although it is not an ancestor!\n");
         } else {
-            if (other.keys.size() == 0) {
-                return *this;
-            } else {
-                return rest().rebase(other.rest());
+            Address result;
+            for (std::size_t i = other.keys.size(); i < keys.size(); i++) {
+                result.push_key(keys[i]);
             }
+            return result;
         }
     }
 
@@ -388,27 +1008,44 @@ class Address {
         asprintf(&buf, format, last().c_str());
         std::string formatted_key(buf);
         free(buf);
-        Address copy(*this);
-        copy.keys.back() = formatted_key;
+        Address copy;
+        for (std::size_t i = 0; i + 1 < keys.size(); i++) {
+            copy.push_key(keys[i]);
+        }
+        copy.push_key(_KeyTable::instance().intern(formatted_key));
         return copy;
     }
 
     std::string to_string(std::string sep = "__") const {
-        return std::accumulate(keys.begin(), keys.end(), std::string(""),
-                               [sep](std::string acc, std::string key) { return ((acc == "") ? "" : acc + sep) + key; });
+        std::string result;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            if (i != 0) {
+                result += sep;
+            }
+            result += key(i);
+        }
+        return result;
     }
 
-    const char* c_str() const {  // for easier use with printf
-        to_string_buf = to_string();
-        return to_string_buf.c_str();
-    }
+    // returns a copy so that const addresses are never modified (eg, printf("%s", address.c_str().c_str()))
+    std::string c_str() const { return to_string(); }
+
+    std::size_t hash() const { return hash_value; }
 
     // for use as key in maps
     bool operator<(const Address& other_address) const {
-        return std::lexicographical_compare(keys.begin(), keys.end(), other_address.keys.begin(), other_address.keys.end());
+        auto& other_keys = other_address.keys;
+        for (std::size_t i = 0; i < keys.size() and i < other_keys.size(); i++) {
+            if (keys[i] != other_keys[i]) {
+                return key(i) < other_address.key(i);
+            }
+        }
+        return keys.size() < other_keys.size();
     }
 
-    bool operator==(const Address& other_address) const { return (keys == other_address.keys); }
+    bool operator==(const Address& other_address) const {
+        return hash_value == other_address.hash_value and keys == other_address.keys;
+    }
 };
 
 struct PortAddress {
@@ -423,9 +1060,15 @@ struct PortAddress {
     }
 };
 
-std::ostream& operator<<(std::ostream& os, const Address& a) { return os << a.to_string(); }
+struct _AddressHash {  // for unordered containers inside tinycompo (std::hash<Address> is only declared at the end)
+    std::size_t operator()(const Address& address) const { return address.hash(); }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Address& a) { return os << a.to_string(); }
 
-std::ostream& operator<<(std::ostream& os, const PortAddress& p) { return os << p.address.to_string() << "." << p.prop; }
+inline std::ostream& operator<<(std::ostream& os, const PortAddress& p) {
+    return os << p.address.to_string() << "." << p.prop;
+}
 
 /*
 =============================================================================================================================
@@ -435,24 +1078,90 @@ Small classes implementing a simple easily explorable graph representation for T
 struct _GraphAddress {
     std::string address;
     std::string port;
+    Address location;  // address as an Address (avoids parsing it back from the string)
 
-    _GraphAddress(const std::string& address, const std::string& port = "") : address(address), port(port) {}
+    _GraphAddress(const Address& location, const std::string& port = "")
+        : address(location.to_string()), port(port), location(location) {}
 
     void print(std::ostream& os = std::cout) const { os << "->" << address << ((port == "") ? "" : ("." + port)); }
 };
 
 /*
 =============================================================================================================================
-  ~*~ _Operation class ~*~
+  ~*~ _Args ~*~
+Stored arguments of a declaration (constructor arguments of a component or arguments of a connector). Two sets of arguments
+are equal if they have the same types and all values compare equal; arguments without operator== (eg, lambdas) never compare
+equal. This is what allows Assembly::update to recognize unchanged parts of a model that was declared anew.
 ===========================================================================================================================*/
-class _Operation {
-    template <class Functor, class... Args>
-    void neighbors_from_args(Args... args) {  // populates the list of neighbors from arguments of the Connector
-        helper1(Functor::_connect, args...);
-    }
+template <class T>
+struct _is_equality_comparable {
+    template <class U>
+    static auto test(int) -> decltype(std::declval<const U&>() == std::declval<const U&>(), std::true_type());
+    template <class>
+    static std::false_type test(...);
+    static constexpr bool value = decltype(test<T>(0))::value;
+};
 
-    template <class... Args, class... CArgs>
-    void helper1(void (*)(Assembly&, Args...), CArgs... cargs) {
+template <class T>
+bool _equal_if_comparable(const T& a, const T& b, std::true_type) {
+    return a == b;
+}
+
+template <class T>
+bool _equal_if_comparable(const T&, const T&, std::false_type) {
+    return false;
+}
+
+template <class... Args, int... S>
+bool _tuple_equal(const std::tuple<Args...>& a, const std::tuple<Args...>& b, _seq<S...>) {
+    bool results[] = {true, _equal_if_comparable(std::get<S>(a), std::get<S>(b),
+                                                 std::integral_constant<bool, _is_equality_comparable<Args>::value>())...};
+    return std::all_of(std::begin(results), std::end(results), [](bool r) { return r; });
+}
+
+template <class... Args>
+bool _tuple_equal(const std::tuple<Args...>& a, const std::tuple<Args...>& b) {
+    return _tuple_equal(a, b, typename _gens<sizeof...(Args)>::type());
+}
+
+struct _AbstractArgs {
+    virtual ~_AbstractArgs() = default;
+    virtual bool equals(const _AbstractArgs& other) const = 0;
+};
+
+template <class Tag, class... Args>  // Tag distinguishes identical arguments passed to different connectors
+struct _Args : public _AbstractArgs {
+    std::tuple<Args...> values;
+
+    explicit _Args(const Args&... args) : values(args...) {}
+
+    template <int... S>
+    void connect_helper(Assembly& assembly, _seq<S...>) const {
+        Tag::_connect(assembly, std::get<S>(values)...);
+    }
+
+    void connect(Assembly& assembly) const {  // when Tag is a connector, calls it with the stored arguments
+        connect_helper(assembly, typename _gens<sizeof...(Args)>::type());
+    }
+
+    bool equals(const _AbstractArgs& other) const override {
+        auto other_ptr = dynamic_cast<const _Args*>(&other);
+        return other_ptr != nullptr and _tuple_equal(values, other_ptr->values);
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ _Operation class ~*~
+===========================================================================================================================*/
+class _Operation {
+    template <class Functor, class... Args>
+    void neighbors_from_args(Args... args) {  // populates the list of neighbors from arguments of the Connector
+        helper1(Functor::_connect, args...);
+    }
+
+    template <class... Args, class... CArgs>
+    void helper1(void (*)(Assembly&, Args...), CArgs... cargs) {
         void (*g)(Args...) = nullptr;  // Double recursion on connect call arguments (cargs) and on argument types of
         helper2(g, cargs...);          // _connect function (through the g pointer). This is necessary because call
     }                                  // arguments might have the wrong type (eg a string instead of an address).
@@ -461,14 +1170,14 @@ class _Operation {
 
     template <class... Args, class CArg, class... CArgs>
     void helper2(void (*)(Address, Args...), CArg carg, CArgs... cargs) {
-        neighbors.push_back(_GraphAddress(Address(carg).to_string()));
+        neighbors.push_back(_GraphAddress(Address(carg)));
         void (*g)(Args...) = nullptr;
         helper2(g, cargs...);
     }
 
     template <class... Args, class... CArgs>
     void helper2(void (*)(PortAddress, Args...), PortAddress carg, CArgs... cargs) {
-        neighbors.push_back(_GraphAddress(carg.address.to_string(), carg.prop));
+        neighbors.push_back(_GraphAddress(carg.address, carg.prop));
         void (*g)(Args...) = nullptr;
         helper2(g, cargs...);
     }
@@ -479,11 +1188,18 @@ class _Operation {
         helper2(g, cargs...);
     }
 
+    static std::size_t next_id() {
+        static std::atomic<std::size_t> counter{0};
+        return counter++;
+    }
+
   public:
     template <class Connector, class... Args>
-    _Operation(_Type<Connector>, Args&&... args)
-        : _connect([args...](Assembly& assembly) { Connector::_connect(assembly, args...); }),
-          type(TinycompoDebug::type<Connector>()) {
+    _Operation(_Type<Connector>, Args&&... args) : type(TinycompoDebug::type<Connector>()) {
+        // arguments are stored once and shared by copies of the operation (and of the models containing it)
+        auto stored = std::make_shared<const _Args<Connector, typename std::decay<Args>::type...>>(args...);
+        _connect = [stored](Assembly& assembly) { stored->connect(assembly); };
+        this->args = stored;
         neighbors_from_args<Connector>(args...);
     }
 
@@ -492,6 +1208,29 @@ class _Operation {
 
     std::function<void(Assembly&)> _connect;
 
+    // identity: copies of an operation share its id, and operations declared with equal arguments are the same
+    std::size_t id{next_id()};
+    std::shared_ptr<const _AbstractArgs> args;  // nullptr if arguments are not stored (eg, configure lambdas)
+
+    bool same_as(const _Operation& other) const {
+        return id == other.id or (args != nullptr and other.args != nullptr and args->equals(*other.args));
+    }
+
+    std::vector<Address> mutated_neighbors() const {  // instances the operation modifies (ie, its ports if it has any)
+        std::vector<Address> result;
+        for (auto& n : neighbors) {
+            if (n.port != "") {
+                result.emplace_back(n.address);
+            }
+        }
+        if (result.empty()) {
+            for (auto& n : neighbors) {
+                result.emplace_back(n.address);
+            }
+        }
+        return result;
+    }
+
     // representation-related stuff
     std::string type;
     std::vector<_GraphAddress> neighbors;
@@ -506,21 +1245,468 @@ class _Operation {
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ ModelGraph ~*~
+Directed graph of the binary connections of a model (operations with a port and an address, such as Use): there is an edge
+from user to provider for every such operation. It is cached in the model (see Model::graph) and kept up to date
+incrementally: each query only indexes the operations and keys declared since the previous one, and appends their nodes and
+edges, so that connectors can alternate declarations and queries. Nodes have integer ids, and the providers and users of a
+node are stored as contiguous arrays of ids. The keys of the model that appear in no connection are nodes too (isolated
+nodes, without edges); a key counts as connected if one of the connected nodes is below it (eg, an element of an array).
+Ids follow the order of indexing: each query adds the nodes of new operations in declaration order, then the new isolated
+keys in declaration order. An isolated node that gets connected later keeps its id, and a key node is hidden (it is no
+longer listed, but its id is not reused) when a connected node appears below it. Copies of a model get the same ids.
+Orders and traversals follow the dependency direction: the ancestors of a node are the nodes it uses, directly or not, and
+a topological sort puts providers before their users. Traversals return nodes in breadth-first order and ties are broken
+by node id, so results are deterministic. Queries run in O(V+E) and indexing in O(1) per new operation or key.
+===========================================================================================================================*/
+class ModelGraph {
+  public:
+    struct IdRange {  // contiguous range of node ids
+        const std::size_t *first, *last;
+        const std::size_t* begin() const { return first; }
+        const std::size_t* end() const { return last; }
+        std::size_t size() const { return last - first; }
+    };
+
+  private:
+    friend class Model;
+
+    enum class _Kind : char { connected, isolated, hidden };
+
+    std::vector<std::string> names;  // node id -> node name
+    std::vector<Address> addresses;  // node id -> node address
+    std::vector<_Kind> kinds;        // node id -> kind of node
+    std::unordered_map<Address, std::size_t, _AddressHash> ids;
+    std::vector<std::pair<std::size_t, std::size_t>> edges;  // (user, provider) in declaration order
+    std::vector<std::vector<std::size_t>> out_ids, in_ids;   // node id -> providers (resp. users) in declaration order
+    std::unordered_set<Address, _AddressHash> connected_keys;  // first keys of connected nodes
+    std::vector<std::string> new_keys;                        // keys declared since the last query (see declare_key)
+    std::size_t nb_keys{0};             // number of keys declared in the model (indexed or in new_keys)
+    std::size_t nb_hidden{0};           // number of hidden nodes
+    std::size_t indexed_operations{0};  // operations of the model that have been looked at
+    mutable std::mutex mutex;           // queries are const on Model, and can happen concurrently
+
+    void add_node(const Address& location, const std::string& name, _Kind kind) {
+        ids.emplace(location, names.size());
+        names.push_back(name);
+        addresses.push_back(location);
+        kinds.push_back(kind);
+        out_ids.emplace_back();
+        in_ids.emplace_back();
+    }
+
+    std::size_t connect(const _GraphAddress& node) {  // id of node, which is marked as connected
+        auto it = ids.find(node.location);
+        if (it != ids.end()) {
+            nb_hidden -= kinds[it->second] == _Kind::hidden;
+            kinds[it->second] = _Kind::connected;
+            return it->second;
+        }
+        add_node(node.location, node.address, _Kind::connected);
+        auto key = node.location.head();
+        connected_keys.insert(key);
+        if (node.location.size() > 1) {  // the node of its key (if any) is replaced by the connected nodes below it
+            auto key_it = ids.find(key);
+            if (key_it != ids.end() and kinds[key_it->second] == _Kind::isolated) {
+                kinds[key_it->second] = _Kind::hidden;
+                nb_hidden++;
+            }
+        }
+        return names.size() - 1;
+    }
+
+    void declare_key(const std::string& key) {  // called by the model when a key is declared
+        new_keys.push_back(key);
+        nb_keys++;
+    }
+
+    // indexes operations and keys declared since last call (components and composites are the maps of the model)
+    template <class Components, class Composites>
+    void update(const std::vector<_Operation>& operations, const Components& components, const Composites& composites) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (operations.size() < indexed_operations or nb_keys != components.size() + composites.size()) {
+            // keys were not declared through the model (eg, restored snapshot): everything is indexed again
+            clear();
+            std::set<std::string> keys;
+            for (auto& c : components) {
+                keys.insert(c.first);
+            }
+            for (auto& c : composites) {
+                keys.insert(c.first);
+            }
+            for (auto& key : keys) {
+                declare_key(key);
+            }
+        }
+        for (; indexed_operations < operations.size(); indexed_operations++) {
+            auto& n = operations[indexed_operations].neighbors;
+            if ((n.size() == 2) and (n[0].port != "") and (n[1].port == "")) {
+                auto user = connect(n[0]);
+                auto provider = connect(n[1]);
+                edges.emplace_back(user, provider);
+                out_ids[user].push_back(provider);
+                in_ids[provider].push_back(user);
+            }
+        }
+        for (auto& key : new_keys) {
+            Address location(key);
+            if (connected_keys.count(location) == 0 and ids.count(location) == 0) {
+                add_node(location, key, _Kind::isolated);
+            }
+        }
+        new_keys.clear();
+    }
+
+    static bool always(const std::string&) { return true; }
+
+    void clear() {
+        names.clear();
+        addresses.clear();
+        kinds.clear();
+        ids.clear();
+        edges.clear();
+        out_ids.clear();
+        in_ids.clear();
+        connected_keys.clear();
+        new_keys.clear();
+        nb_keys = nb_hidden = indexed_operations = 0;
+    }
+
+    /* Breadth-first traversal from name (excluded) following next(node). Visited nodes for which keep returns true are
+    added to the result; they are only traversed further if stop_at_kept is false (other nodes always are). */
+    template <class Next>
+    std::vector<std::string> traverse(const std::string& name, Next next, std::function<bool(const std::string&)> keep,
+                                      bool stop_at_kept) const {
+        std::vector<bool> visited(names.size(), false);
+        std::vector<std::size_t> queue{id(name)};
+        std::vector<std::string> result;
+        visited[queue.front()] = true;
+        for (std::size_t i = 0; i < queue.size(); i++) {
+            for (auto neighbor : next(queue[i])) {
+                if (!visited[neighbor]) {
+                    visited[neighbor] = true;
+                    bool kept = keep(names[neighbor]);
+                    if (kept) {
+                        result.push_back(names[neighbor]);
+                    }
+                    if (!kept or !stop_at_kept) {
+                        queue.push_back(neighbor);
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+  public:
+    ModelGraph() = default;
+
+    ModelGraph(const ModelGraph& other) { *this = other; }
+    ModelGraph(ModelGraph&& other) { *this = std::move(other); }
+
+    ModelGraph& operator=(const ModelGraph& other) {
+        if (this != &other) {
+            std::lock_guard<std::mutex> lock(other.mutex);
+            names = other.names;
+            addresses = other.addresses;
+            kinds = other.kinds;
+            ids = other.ids;
+            edges = other.edges;
+            out_ids = other.out_ids;
+            in_ids = other.in_ids;
+            connected_keys = other.connected_keys;
+            new_keys = other.new_keys;
+            nb_keys = other.nb_keys;
+            nb_hidden = other.nb_hidden;
+            indexed_operations = other.indexed_operations;
+        }
+        return *this;
+    }
+
+    ModelGraph& operator=(ModelGraph&& other) {
+        if (this != &other) {
+            std::lock_guard<std::mutex> lock(other.mutex);
+            names = std::move(other.names);
+            addresses = std::move(other.addresses);
+            kinds = std::move(other.kinds);
+            ids = std::move(other.ids);
+            edges = std::move(other.edges);
+            out_ids = std::move(other.out_ids);
+            in_ids = std::move(other.in_ids);
+            connected_keys = std::move(other.connected_keys);
+            new_keys = std::move(other.new_keys);
+            nb_keys = other.nb_keys;
+            nb_hidden = other.nb_hidden;
+            indexed_operations = other.indexed_operations;
+            other.clear();
+        }
+        return *this;
+    }
+
+    std::size_t size() const { return names.size() - nb_hidden; }  // number of nodes, isolated ones included
+    std::size_t nb_edges() const { return edges.size(); }
+    bool isolated(std::size_t id) const { return kinds.at(id) == _Kind::isolated; }
+    const std::string& name(std::size_t id) const { return names.at(id); }
+    const Address& address(std::size_t id) const { return addresses.at(id); }
+
+    std::vector<std::string> nodes() const {  // node names, by id
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < names.size(); i++) {
+            if (kinds[i] != _Kind::hidden) {
+                result.push_back(names[i]);
+            }
+        }
+        return result;
+    }
+
+    bool contains(const std::string& name) const {
+        auto it = ids.find(Address(name));
+        return it != ids.end() and kinds[it->second] != _Kind::hidden;
+    }
+
+    std::size_t id(const std::string& name) const {
+        auto it = ids.find(Address(name));
+        if (it == ids.end() or kinds[it->second] == _Kind::hidden) {
+            throw TinycompoException("<ModelGraph::id> Node " + name + " does not exist");
+        }
+        return it->second;
+    }
+
+    IdRange providers(std::size_t id) const {  // nodes that id uses
+        auto& targets = out_ids.at(id);
+        return IdRange{targets.data(), targets.data() + targets.size()};
+    }
+
+    IdRange users(std::size_t id) const {  // nodes that use id
+        auto& targets = in_ids.at(id);
+        return IdRange{targets.data(), targets.data() + targets.size()};
+    }
+
+    DirectedGraph digraph() const {  // without isolated nodes
+        std::multimap<std::string, std::string> edge_map;
+        for (auto& e : edges) {
+            edge_map.emplace(names[e.first], names[e.second]);
+        }
+        std::set<std::string> connected;
+        for (std::size_t i = 0; i < names.size(); i++) {
+            if (kinds[i] == _Kind::connected) {
+                connected.insert(names[i]);
+            }
+        }
+        return std::make_pair(connected, edge_map);
+    }
+
+    std::vector<std::size_t> topological_order() const {  // node ids, providers before users
+        std::vector<std::size_t> remaining(names.size());  // number of providers not yet in result
+        std::vector<std::size_t> ready;
+        for (std::size_t i = 0; i < names.size(); i++) {
+            remaining[i] = providers(i).size();
+            if (remaining[i] == 0 and kinds[i] != _Kind::hidden) {
+                ready.push_back(i);
+            }
+        }
+        for (std::size_t next = 0; next < ready.size(); next++) {  // ready doubles as a FIFO queue
+            for (auto user : users(ready[next])) {
+                if (--remaining[user] == 0) {
+                    ready.push_back(user);
+                }
+            }
+        }
+        if (ready.size() != size()) {
+            std::string cycle;
+            for (std::size_t i = 0; i < names.size(); i++) {
+                if (remaining[i] != 0) {
+                    cycle += "  * " + names[i] + "\n";
+                }
+            }
+            throw TinycompoException("<ModelGraph::topological_order> Graph has cycles. Nodes on or after a cycle:\n" +
+                                     cycle);
+        }
+        return ready;
+    }
+
+    std::vector<std::string> topological_sort() const {  // node names, providers before users
+        std::vector<std::string> result;
+        for (auto id : topological_order()) {
+            result.push_back(names[id]);
+        }
+        return result;
+    }
+
+    std::vector<std::string> ancestors(const std::string& name) const {  // nodes name uses, directly or not
+        return traverse(name, [this](std::size_t n) { return providers(n); }, always, false);
+    }
+
+    std::vector<std::string> descendants(const std::string& name) const {  // nodes that use name, directly or not
+        return traverse(name, [this](std::size_t n) { return users(n); }, always, false);
+    }
+
+    /* Markov-blanket-like queries: nearest users (resp. providers) of name for which keep returns true. Nodes for which it
+    returns false are looked through, ie their own users (resp. providers) are considered instead. */
+    std::vector<std::string> nearest_users(const std::string& name, std::function<bool(const std::string&)> keep) const {
+        return traverse(name, [this](std::size_t n) { return users(n); }, keep, true);
+    }
+
+    std::vector<std::string> nearest_providers(const std::string& name,
+                                               std::function<bool(const std::string&)> keep) const {
+        return traverse(name, [this](std::size_t n) { return providers(n); }, keep, true);
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Interfaces ~*~
+Components can list the interfaces they implement in a member type named interfaces, eg:
+    struct MyInt : public Component, public IntInterface {
+        using interfaces = Interfaces<IntInterface>;
+    };
+The list is checked at compile time and recorded in a cast table along with the type of the component (and whether it is
+a Component and an Assembly) when the component is declared in a model. Type queries on declarations (Model::has_type)
+look these types up in the table, which is immutable, so they need no lock. Other types are handled by _CastProbe.
+===========================================================================================================================*/
+template <class... Ts>
+struct Interfaces {};
+
+using _CastTable = std::vector<std::pair<std::type_index, bool>>;  // type -> whether the component can be cast to it
+
+template <class T>
+struct _declared_interfaces {  // T::interfaces if it exists, Interfaces<> otherwise
+    template <class U>
+    static typename U::interfaces test(int);
+    template <class>
+    static Interfaces<> test(...);
+    using type = decltype(test<T>(0));
+};
+
+template <bool...>
+struct _bool_pack {};
+
+template <bool... Bs>
+using _all_true = std::is_same<_bool_pack<true, Bs...>, _bool_pack<Bs..., true>>;
+
+template <class T>
+const _CastTable& _cast_table();  // defined after Assembly
+
+inline std::size_t& _cast_probe_count() {  // probes thrown by the current thread (see _CastProbe, used by tests)
+    static thread_local std::size_t count{0};
+    return count;
+}
+
+/*
+=============================================================================================================================
+  ~*~ _Builder class ~*~
+Stores the arguments of a constructor call for a Component child class T, and performs said call on demand (either with new
+or in memory provided by the caller). _AbstractBuilder is its type-erased interface.
+===========================================================================================================================*/
+struct _AbstractBuilder {
+    virtual ~_AbstractBuilder() = default;
+    virtual Component* construct() const = 0;
+    virtual Component* construct_at(void* place) const = 0;  // place must be suitable for an object of size()/alignment()
+    virtual std::size_t size() const = 0;
+    virtual std::size_t alignment() const = 0;
+    virtual const std::type_info& type_info() const = 0;
+    virtual const _CastTable& cast_table() const = 0;  // see Interfaces
+    virtual void throw_pointer() const = 0;            // throws a null pointer to the built type (see _CastProbe)
+    virtual bool equals(const _AbstractBuilder& other) const = 0;  // same type and equal arguments (see _Args)
+};
+
+template <class T, class... Args>
+class _Builder : public _AbstractBuilder {
+    std::tuple<Args...> args;
+
+    template <int... S>
+    Component* construct_helper(_seq<S...>) const {
+        return dynamic_cast<Component*>(new T(std::get<S>(args)...));
+    }
+
+    template <int... S>
+    Component* construct_at_helper(void* place, _seq<S...>) const {
+        return dynamic_cast<Component*>(new (place) T(std::get<S>(args)...));
+    }
+
+  public:
+    explicit _Builder(const Args&... args) : args(args...) {}
+
+    const std::tuple<Args...>& arguments() const { return args; }
+
+    Component* construct() const override { return construct_helper(typename _gens<sizeof...(Args)>::type()); }
+    Component* construct_at(void* place) const override {
+        return construct_at_helper(place, typename _gens<sizeof...(Args)>::type());
+    }
+    std::size_t size() const override { return sizeof(T); }
+    std::size_t alignment() const override { return alignof(T); }
+    const std::type_info& type_info() const override { return typeid(T); }
+    const _CastTable& cast_table() const override { return _cast_table<T>(); }
+    void throw_pointer() const override { throw static_cast<T*>(nullptr); }
+    bool equals(const _AbstractBuilder& other) const override {
+        auto other_ptr = dynamic_cast<const _Builder*>(&other);
+        return other_ptr != nullptr and _tuple_equal(args, other_ptr->args);
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ _CastProbe ~*~
+Tells whether the type built by a builder derives from Target without building anything. Types recorded in the cast table
+of the builder (see Interfaces) are answered from the table. For other types, a pointer to the built type is thrown and
+caught as Target*, which succeeds exactly when a dynamic_cast of an instance to Target* would. Since exceptions are slow,
+results are cached per thread and built type, so that only the first query of a thread for each pair of types throws.
+===========================================================================================================================*/
+template <class Target>
+struct _CastProbe {
+    static bool castable(const _AbstractBuilder& builder) {
+        std::type_index target(typeid(Target));
+        for (auto& entry : builder.cast_table()) {
+            if (entry.first == target) {
+                return entry.second;
+            }
+        }
+        static thread_local std::unordered_map<std::type_index, bool> cache;  // per thread, so that it needs no lock
+        std::type_index built(builder.type_info());
+        auto it = cache.find(built);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        bool result = false;
+        _cast_probe_count()++;
+        try {
+            builder.throw_pointer();
+        } catch (Target*) {
+            result = true;
+        } catch (...) {
+        }
+        cache.emplace(built, result);
+        return result;
+    }
+};
+
 /*
 =============================================================================================================================
   ~*~ _ComponentBuilder class ~*~
 A small class that is capable of storing a constructor call for any Component child class and execute said call later on
-demand. The class itself is not templated (allowing direct storage) but the constructor call is. This is an internal
+demand. The class itself is not templated (allowing direct storage) but the constructor call is. The call is stored in a
+_Builder which is shared between copies (copying a model does not copy constructor arguments). This is an internal
 tinycompo class that should never be seen by the user (as denoted by the underscore prefix).
 ===========================================================================================================================*/
 struct _ComponentBuilder {
     template <class T, class... Args>
     _ComponentBuilder(_Type<T>, const std::string& name, Args... args)
-        : _constructor([=]() { return std::unique_ptr<Component>(dynamic_cast<Component*>(new T(args...))); }),
-          type(TinycompoDebug::type<T>()),
-          name(name) {}
+        : builder(std::make_shared<const _Builder<T, Args...>>(args...)), type(TinycompoDebug::type<T>()), name(name) {}
+
+    std::shared_ptr<const _AbstractBuilder> builder;  // stores the component constructor and its arguments
+
+    std::unique_ptr<Component> _constructor() const { return std::unique_ptr<Component>(builder->construct()); }
+
+    template <class T>
+    bool derives_from() const {  // whether the component will derive from T (without constructing it)
+        return _CastProbe<T>::castable(*builder);
+    }
 
-    std::function<std::unique_ptr<Component>()> _constructor;  // stores the component constructor
+    bool same_as(const _ComponentBuilder& other) const {
+        return builder == other.builder or builder->equals(*other.builder);
+    }
 
     // representation-related stuff
     std::string type;
@@ -570,21 +1756,9 @@ class _Driver : public Component, public _AbstractDriver {
     std::function<void(Refs...)> instructions;
     std::tuple<Refs...> refs;
 
-    // C++11 integer_sequence implementation :/
-    template <int...>
-    struct seq {};
-
-    template <int N, int... S>
-    struct gens : gens<N - 1, N - 1, S...> {};
-
-    template <int... S>
-    struct gens<0, S...> {
-        typedef seq<S...> type;
-    };
-
     // helper functions
     template <int... S>
-    void call_helper(seq<S...>) {
+    void call_helper(_seq<S...>) {
         instructions(std::get<S>(refs)...);
     }
 
@@ -600,7 +1774,7 @@ class _Driver : public Component, public _AbstractDriver {
     // port to set the references (invariant : vector should have the same size as Refs)
     void set_refs(std::vector<Component*> ref_values) override { set_ref_helper<0, Refs...>(ref_values); }
 
-    void go() override { call_helper(typename gens<sizeof...(Refs)>::type()); }
+    void go() override { call_helper(typename _gens<sizeof...(Refs)>::type()); }
 
   public:
     _Driver(const std::function<void(Refs...)>& instructions) : instructions(instructions) {
@@ -613,14 +1787,34 @@ class _Driver : public Component, public _AbstractDriver {
 =============================================================================================================================
   ~*~ Model ~*~
 ===========================================================================================================================*/
+inline std::size_t& _model_copy_count() {  // models copied by the current thread, sub-models included (used by tests)
+    static thread_local std::size_t count{0};
+    return count;
+}
+
 class Model {
     friend class Assembly;  // to access internal data
     friend class Introspector;
+    friend class _ArenaStorage;
+    friend class Snapshot;
 
-    // state of model
+    // state of model (copies of a model are deep: sub-models are copied, builders and connector arguments are shared)
+    using _CompositeDecl = std::pair<std::shared_ptr<Model>, _ComponentBuilder>;
     std::map<std::string, _ComponentBuilder> components;
     std::vector<_Operation> operations;
-    std::map<std::string, std::pair<Model, _ComponentBuilder>> composites;
+    std::map<std::string, _CompositeDecl> composites;
+    mutable ModelGraph graph_cache;  // see graph()
+    std::size_t nb_indices{0};       // number of keys that are array indices (see all_indices)
+    int max_index{-1};               // largest of these indices
+
+    void declare_key(const std::string& key) {  // called once a key has been added to components or composites
+        graph_cache.declare_key(key);
+        int index = _KeyTable::parse_index(key);
+        if (index >= 0) {
+            nb_indices++;
+            max_index = std::max(max_index, index);
+        }
+    }
 
     // helper functions
     std::string strip(std::string s) const {
@@ -664,8 +1858,11 @@ class Model {
     template <class T, class CallKey, class... Args>
     ComponentReference component_call_helper(IsConcrete, IsComponent, IsNotAddress, CallKey key, Args&&... args) {
         std::string key_name = key_to_string(key);
-        components.emplace(std::piecewise_construct, std::forward_as_tuple(key_name),
-                           std::forward_as_tuple(_Type<T>(), key_name, std::forward<Args>(args)...));
+        auto declared = components.emplace(std::piecewise_construct, std::forward_as_tuple(key_name),
+                                           std::forward_as_tuple(_Type<T>(), key_name, std::forward<Args>(args)...));
+        if (declared.second) {
+            declare_key(key_name);
+        }
         return ComponentReference(*this, Address(key));
     }
 
@@ -673,12 +1870,16 @@ class Model {
     ComponentReference component_call_helper(IsConcrete, IsComposite, IsNotAddress, CallKey key, Args&&... args) {
         std::string key_name = key_to_string(key);
 
-        Model m;
-        T::contents(m, args...);
+        auto m = std::make_shared<Model>();
+        T::contents(*m, args...);
 
-        composites.emplace(std::piecewise_construct, std::forward_as_tuple(key_name),
-                           std::forward_as_tuple(std::piecewise_construct, std::forward_as_tuple(m),
-                                                 std::forward_as_tuple(_Type<T>(), key_name)));
+        auto declared = composites.emplace(
+            std::piecewise_construct, std::forward_as_tuple(key_name),
+            std::forward_as_tuple(std::piecewise_construct, std::forward_as_tuple(std::move(m)),
+                                  std::forward_as_tuple(_Type<T>(), key_name)));
+        if (declared.second) {
+            declare_key(key_name);
+        }
         return ComponentReference(*this, Address(key));
     }
 
@@ -700,7 +1901,7 @@ class Model {
             result.emplace_back(Address(parent, c.first));
         }
         for (auto&& c : composites) {
-            auto recursive_result = c.second.first.all_addresses_helper(Address(parent, c.first));
+            auto recursive_result = c.second.first->all_addresses_helper(Address(parent, c.first));
             result.insert(result.end(), recursive_result.begin(), recursive_result.end());
         }
         return result;
@@ -708,6 +1909,27 @@ class Model {
 
   public:
     Model() = default;  // when creating model from scratch
+    Model(Model&&) = default;
+    Model& operator=(Model&&) = default;
+
+    Model(const Model& other)
+        : components(other.components),
+          operations(other.operations),
+          composites(other.composites),
+          graph_cache(other.graph_cache),
+          nb_indices(other.nb_indices),
+          max_index(other.max_index) {
+        _model_copy_count()++;
+        for (auto& c : composites) {  // sub-models are not shared between copies
+            c.second.first = std::make_shared<Model>(*c.second.first);
+        }
+    }
+
+    Model& operator=(const Model& other) {
+        Model copy(other);
+        *this = std::move(copy);
+        return *this;
+    }
 
     template <class T, class... Args>
     Model(_Type<T>, Args... args) {  // when instantiating from composite content function
@@ -754,7 +1976,7 @@ class Model {
                 throw TinycompoException("Composite not found. Composite " + key_name +
                                          " does not exist. Existing composites are:\n" + TinycompoDebug::list(composites));
             } else {
-                return dynamic_cast<Model&>(compositeIt->second.first);
+                return *compositeIt->second.first;
             }
         }
     }
@@ -769,7 +1991,7 @@ class Model {
                 throw TinycompoException("Composite not found. Composite " + key_name +
                                          " does not exist. Existing composites are:\n" + TinycompoDebug::list(composites));
             } else {
-                return dynamic_cast<const Model&>(compositeIt->second.first);
+                return *compositeIt->second.first;
             }
         }
     }
@@ -779,12 +2001,15 @@ class Model {
         if (address.is_composite()) {  // address is composite (several names)
             return get_composite(address.first()).has_type<T>(address.rest());
         } else {
-            if (is_composite(address)) {  // non-composite address corresponds to a composite
-                return false;             // composite don't have types
-            } else {
-                auto tmp_ptr = components.at(address.to_string())._constructor();
-                return dynamic_cast<T*>(tmp_ptr.get()) != nullptr;
+            if (composites.count(address.first()) != 0) {  // non-composite address corresponds to a composite
+                return false;                              // composite don't have types
+            }
+            auto it = components.find(address.first());
+            if (it == components.end()) {
+                throw TinycompoException("<Model::has_type> Component " + address.first() +
+                                         " does not exist. Existing components are:\n" + TinycompoDebug::list(components));
             }
+            return it->second.derives_from<T>();
         }
     }
 
@@ -794,7 +2019,7 @@ class Model {
         } else {
             bool result = false;
             for (auto& c : composites) {
-                result = result or c.first == address.first() or c.second.first.is_composite(address.first());
+                result = result or c.first == address.first() or c.second.first->is_composite(address.first());
             }
             return result;
         }
@@ -818,20 +2043,13 @@ class Model {
         dot(file);
     }
 
-    DirectedGraph get_digraph() const {
-        std::set<std::string> nodes;
-        std::multimap<std::string, std::string> edges;
-        for (auto c : operations) {
-            // if connector is of the form (PortAddress, Address)
-            if ((c.neighbors.size() == 2) and (c.neighbors[0].port != "") and (c.neighbors[1].port == "")) {
-                edges.insert(make_pair(c.neighbors[0].address, c.neighbors[1].address));
-                nodes.insert(c.neighbors[0].address);
-                nodes.insert(c.neighbors[1].address);
-            }
-        }
-        return make_pair(nodes, edges);
+    const ModelGraph& graph() const {  // indexes operations declared since the last call (see ModelGraph)
+        graph_cache.update(operations, components, composites);
+        return graph_cache;
     }
 
+    DirectedGraph get_digraph() const { return graph().digraph(); }
+
     void to_dot(int tabs = 0, const std::string& name = "", std::ostream& os = std::cout) const {
         std::string prefix = name + (name == "" ? "" : "__");
         if (name == "") {  // toplevel
@@ -855,7 +2073,7 @@ class Model {
             i++;
         }
         for (auto& c : composites) {
-            c.second.first.to_dot(tabs + 1, prefix + c.first, os);
+            c.second.first->to_dot(tabs + 1, prefix + c.first, os);
         }
         os << std::string(tabs, '\t') << "}\n";
     }
@@ -869,7 +2087,7 @@ class Model {
         }
         for (auto& c : composites) {
             os << std::string(tabs, '\t') << "Composite " << c.first << " {\n";
-            c.second.first.print(os, tabs + 1);
+            c.second.first->print(os, tabs + 1);
             os << std::string(tabs, '\t') << "}\n";
         }
     }
@@ -880,7 +2098,7 @@ class Model {
             result.emplace_back(c.first);
         }
         for (auto&& c : composites) {
-            auto recursive_result = c.second.first.all_addresses_helper(c.first);
+            auto recursive_result = c.second.first->all_addresses_helper(c.first);
             result.insert(result.end(), recursive_result.begin(), recursive_result.end());
         }
         return result;
@@ -902,12 +2120,35 @@ class Model {
         }
         if (depth > 0) {
             for (auto& c : composites) {  // names from composites until a certain depth
-                auto subresult = c.second.first.all_component_names(depth - 1, include_composites, prefix + c.first);
+                auto subresult = c.second.first->all_component_names(depth - 1, include_composites, prefix + c.first);
                 result.insert(result.end(), subresult.begin(), subresult.end());
             }
         }
         return result;
     }
+
+    std::vector<int> all_indices() const {  // local keys that are array indices (see _KeyTable::parse_index), sorted
+        std::vector<int> result;
+        if (static_cast<std::size_t>(max_index + 1) == nb_indices) {  // keys are unique: indices are exactly 0 to max
+            result.resize(nb_indices);
+            std::iota(result.begin(), result.end(), 0);
+            return result;
+        }
+        for (auto& c : components) {
+            int index = _KeyTable::parse_index(c.first);
+            if (index >= 0) {
+                result.push_back(index);
+            }
+        }
+        for (auto& c : composites) {
+            int index = _KeyTable::parse_index(c.first);
+            if (index >= 0) {
+                result.push_back(index);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
 };
 
 /*
@@ -926,16 +2167,16 @@ class Introspector {
 
     template <class T>
     void acc_composites_ref(T& acc, std::function<void(T&, Introspector&)> f) const {
-        for (auto composite : m.composites) {
-            Introspector i(composite.second.first);
+        for (auto& composite : m.composites) {
+            Introspector i(*composite.second.first);
             f(acc, i);
         }
     }
 
     template <class T>
     void acc_composites_ref(T& acc, std::function<void(T&, Introspector&, Address)> f) const {
-        for (auto composite : m.composites) {
-            Introspector i(composite.second.first);
+        for (auto& composite : m.composites) {
+            Introspector i(*composite.second.first);
             f(acc, i, composite.first);
         }
     }
@@ -964,129 +2205,1589 @@ class Introspector {
     ~*~ Topology-related functions ~*~  */
     std::vector<Address> components() const {
         std::vector<Address> result;
-        for (auto component : m.components) {
+        for (auto& component : m.components) {
             result.emplace_back(component.first);
         }
-        for (auto composite : m.composites) {
+        for (auto& composite : m.composites) {
             result.emplace_back(composite.first);
         }
         return result;
     }
 
-    std::vector<Address> deep_components(Address prefix = Address()) const {
-        std::vector<Address> result;
-        for (auto component : m.components) {
-            result.emplace_back(prefix, component.first);
+    std::vector<Address> deep_components(Address prefix = Address()) const {
+        std::vector<Address> result;
+        for (auto& component : m.components) {
+            result.emplace_back(prefix, component.first);
+        }
+        acc_composites_ref<std::vector<Address>>(result, [](std::vector<Address>& acc, Introspector& i, Address context) {
+            auto tmp = i.deep_components(context);
+            acc.insert(acc.end(), tmp.begin(), tmp.end());
+        });
+        return result;
+    }
+
+    std::vector<std::pair<PortAddress, Address>> directed_binops(Address prefix = Address()) const {
+        std::vector<std::pair<PortAddress, Address>> result;
+
+        for (auto& operation : m.operations) {
+            auto& n = operation.neighbors;
+            if (n.size() == 2 and n.at(0).port != "" and n.at(1).port == "") {
+                PortAddress origin(n.at(0).port, Address(prefix, Address(n.at(0).address)));
+                Address dest(prefix, Address(n.at(1).address));
+                result.emplace_back(origin, dest);
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::pair<PortAddress, Address>> deep_directed_binops(Address prefix = Address()) const {
+        using t = std::vector<std::pair<PortAddress, Address>>;
+        auto result = directed_binops(prefix);
+        acc_composites_ref<t>(result, [](t& acc, Introspector& i, Address context) {
+            auto tmp = i.deep_directed_binops(context);
+            acc.insert(acc.end(), tmp.begin(), tmp.end());
+        });
+        return result;
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Snapshot ~*~
+Binary snapshot of a model: components and composites (recursively) with their constructor arguments, and operations with
+their arguments, as they are stored in the model. Composite contents functions and meta connectors are thus not executed
+again when loading. Component types (with their constructor argument types) and connectors (with their argument types) must
+be registered under a name beforehand, eg:
+    Snapshot::register_component<MyInt, int>("MyInt");
+    Snapshot::register_component<Array<MyInt>>("Array<MyInt>");  // composites have no constructor arguments
+    Snapshot::register_connector<Use<IntInterface>, PortAddress, Address>("Use<IntInterface>");
+Argument types must be stored exactly as in the model (ie, decayed types of the arguments of the declaration call). Supported
+argument types are arithmetic types, enums, strings (and const char*), Address, PortAddress and vectors of those. Lambda
+arguments (configure, driver) cannot be saved. Numbers are stored in the native representation of the machine. Type names
+are only written once (further uses refer to them by index) and loading parses the snapshot from memory.
+===========================================================================================================================*/
+class _SnapshotReader {
+    std::string buffer;
+    std::size_t position{0};
+
+  public:
+    explicit _SnapshotReader(std::istream& is) {
+        std::stringstream ss;
+        ss << is.rdbuf();
+        buffer = ss.str();
+    }
+
+    void read(void* data, std::size_t size) {
+        if (size > buffer.size() - position) {
+            throw TinycompoException("<Snapshot::load> Unexpected end of snapshot");
+        }
+        memcpy(data, buffer.data() + position, size);
+        position += size;
+    }
+};
+
+template <class T>
+struct _SnapshotIO {  // arithmetic types and enums
+    static_assert(std::is_arithmetic<T>::value or std::is_enum<T>::value, "This type cannot be stored in a snapshot");
+    static void write(std::ostream& os, const T& value) { os.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+    template <class Reader>
+    static T read(Reader& is) {
+        T value;
+        is.read(&value, sizeof(T));
+        return value;
+    }
+};
+
+template <>
+struct _SnapshotIO<std::string> {
+    static void write(std::ostream& os, const std::string& value) {
+        _SnapshotIO<std::uint64_t>::write(os, value.size());
+        os.write(value.data(), value.size());
+    }
+    template <class Reader>
+    static std::string read(Reader& is) {  // in bounded chunks so that a corrupted size fails instead of being allocated
+        auto size = _SnapshotIO<std::uint64_t>::read(is);
+        std::string value;
+        char chunk[4096];
+        while (value.size() < size) {
+            auto n = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(chunk), size - value.size()));
+            is.read(chunk, n);
+            value.append(chunk, n);
+        }
+        return value;
+    }
+};
+
+template <>
+struct _SnapshotIO<const char*> {  // loaded strings are interned so that they live as long as the program
+    static void write(std::ostream& os, const char* value) { _SnapshotIO<std::string>::write(os, value); }
+    template <class Reader>
+    static const char* read(Reader& is) {
+        return _KeyTable::instance().stored(_SnapshotIO<std::string>::read(is)).c_str();
+    }
+};
+
+template <class T>
+struct _SnapshotIO<std::vector<T>> {
+    static void write(std::ostream& os, const std::vector<T>& value) {
+        _SnapshotIO<std::uint64_t>::write(os, value.size());
+        for (auto& e : value) {
+            _SnapshotIO<T>::write(os, e);
+        }
+    }
+    template <class Reader>
+    static std::vector<T> read(Reader& is) {
+        std::vector<T> value;
+        auto size = _SnapshotIO<std::uint64_t>::read(is);
+        for (std::uint64_t i = 0; i < size; i++) {
+            value.push_back(_SnapshotIO<T>::read(is));
+        }
+        return value;
+    }
+};
+
+template <>
+struct _SnapshotIO<Address> {
+    static void write(std::ostream& os, const Address& value) {
+        _SnapshotIO<std::uint64_t>::write(os, value.size());
+        for (std::size_t i = 0; i < value.size(); i++) {
+            _SnapshotIO<std::string>::write(os, value.key(i));
+        }
+    }
+    template <class Reader>
+    static Address read(Reader& is) {
+        Address value;
+        auto size = _SnapshotIO<std::uint64_t>::read(is);
+        for (std::uint64_t i = 0; i < size; i++) {
+            value = Address(value, _SnapshotIO<std::string>::read(is));
+        }
+        return value;
+    }
+};
+
+template <>
+struct _SnapshotIO<PortAddress> {
+    static void write(std::ostream& os, const PortAddress& value) {
+        _SnapshotIO<std::string>::write(os, value.prop);
+        _SnapshotIO<Address>::write(os, value.address);
+    }
+    template <class Reader>
+    static PortAddress read(Reader& is) {
+        auto prop = _SnapshotIO<std::string>::read(is);
+        return PortAddress(prop, _SnapshotIO<Address>::read(is));
+    }
+};
+
+template <class... Args, int... S>
+void _snapshot_write_tuple(std::ostream& os, const std::tuple<Args...>& values, _seq<S...>) {
+    int dummy[] = {0, (_SnapshotIO<Args>::write(os, std::get<S>(values)), 0)...};
+    (void)dummy;
+}
+
+class Snapshot {
+    struct _ComponentEntry {
+        std::string name;
+        bool composite;
+        std::function<void(std::ostream&, const _AbstractBuilder&)> save;
+        std::function<void(Model&, const std::string&, _SnapshotReader&)> load;  // components
+        std::function<void(Model&, const std::string&, Model&&)> load_composite;
+    };
+
+    struct _ConnectorEntry {
+        std::string name;
+        std::function<void(std::ostream&, const _AbstractArgs&)> save;
+        std::function<void(Model&, _SnapshotReader&)> load;
+    };
+
+    template <class Entry>
+    struct _Registry {
+        std::unordered_map<std::string, Entry> by_name;
+        std::unordered_map<std::string, std::string> name_by_type;  // by std::type_info::name
+
+        void add(const std::type_info& type, Entry entry) {
+            auto it = name_by_type.find(type.name());
+            if (it != name_by_type.end() and it->second != entry.name) {
+                throw TinycompoException("<Snapshot::register> Type " + TinycompoDebug::type(type) +
+                                         " is already registered as " + it->second);
+            }
+            if (it == name_by_type.end() and by_name.count(entry.name) != 0) {
+                throw TinycompoException("<Snapshot::register> Name " + entry.name + " is already used");
+            }
+            name_by_type[type.name()] = entry.name;
+            by_name[entry.name] = std::move(entry);
+        }
+
+        const Entry& at(const std::type_info& type, const std::string& what) const {
+            auto it = name_by_type.find(type.name());
+            if (it == name_by_type.end()) {
+                throw TinycompoException("<Snapshot::save> " + what + " has unregistered type " +
+                                         TinycompoDebug::type(type));
+            }
+            return by_name.at(it->second);
+        }
+
+        const Entry& at(const std::string& name) const {
+            auto it = by_name.find(name);
+            if (it == by_name.end()) {
+                throw TinycompoException("<Snapshot::load> Unknown type name " + name + " (it must be registered)");
+            }
+            return it->second;
+        }
+    };
+
+    static _Registry<_ComponentEntry>& components() {
+        static _Registry<_ComponentEntry> registry;
+        return registry;
+    }
+
+    static _Registry<_ConnectorEntry>& connectors() {
+        static _Registry<_ConnectorEntry> registry;
+        return registry;
+    }
+
+    static const char* magic() { return "tinycompo-snapshot-1"; }
+
+    struct _SaveState {  // indices of type names already written
+        std::unordered_map<std::string, std::uint32_t> components, connectors;
+    };
+
+    struct _LoadState {  // entries of type names already read, by index
+        std::vector<const _ComponentEntry*> components;
+        std::vector<const _ConnectorEntry*> connectors;
+    };
+
+    // a type name is written in full after its index the first time it is used
+    static void write_name(std::ostream& os, std::unordered_map<std::string, std::uint32_t>& names,
+                           const std::string& name) {
+        auto it = names.emplace(name, static_cast<std::uint32_t>(names.size()));
+        _SnapshotIO<std::uint32_t>::write(os, it.first->second);
+        if (it.second) {
+            _SnapshotIO<std::string>::write(os, name);
+        }
+    }
+
+    template <class Entry>
+    static const Entry& read_name(_SnapshotReader& is, std::vector<const Entry*>& entries,
+                                  const _Registry<Entry>& registry) {
+        auto index = _SnapshotIO<std::uint32_t>::read(is);
+        if (index == entries.size()) {
+            entries.push_back(&registry.at(_SnapshotIO<std::string>::read(is)));
+        } else if (index > entries.size()) {
+            throw TinycompoException("<Snapshot::load> Corrupted snapshot");
+        }
+        return *entries[index];
+    }
+
+    template <class T, class... Args>
+    struct _ComponentLoader {
+        template <int... S>
+        static void load(Model& model, const std::string& key, std::tuple<Args...>&& values, _seq<S...>) {
+            auto declared = model.components.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                                                     std::forward_as_tuple(_Type<T>(), key, std::get<S>(values)...));
+            if (declared.second) {
+                model.declare_key(key);
+            }
+        }
+    };
+
+    template <class C, class... Args>
+    struct _ConnectorLoader {
+        template <int... S>
+        static void load(Model& model, std::tuple<Args...>&& values, _seq<S...>) {
+            model.connect<C>(std::get<S>(values)...);
+        }
+    };
+
+    template <class T, class... Args>
+    static void register_helper(const std::string& name, std::false_type) {  // component
+        _ComponentEntry entry;
+        entry.name = name;
+        entry.composite = false;
+        entry.save = [](std::ostream& os, const _AbstractBuilder& builder) {
+            _snapshot_write_tuple(os, static_cast<const _Builder<T, Args...>&>(builder).arguments(),
+                                  typename _gens<sizeof...(Args)>::type());
+        };
+        entry.load = [](Model& model, const std::string& key, _SnapshotReader& is) {
+            std::tuple<Args...> values{_SnapshotIO<Args>::read(is)...};  // braces: read in order
+            _ComponentLoader<T, Args...>::load(model, key, std::move(values), typename _gens<sizeof...(Args)>::type());
+        };
+        components().add(typeid(_Builder<T, Args...>), std::move(entry));
+    }
+
+    template <class T, class... Args>
+    static void register_helper(const std::string& name, std::true_type) {  // composite
+        static_assert(sizeof...(Args) == 0, "Composites are declared without constructor arguments");
+        _ComponentEntry entry;
+        entry.name = name;
+        entry.composite = true;
+        entry.load_composite = [](Model& model, const std::string& key, Model&& contents) {
+            auto sub_model = std::make_shared<Model>(std::move(contents));
+            auto declared = model.composites.emplace(
+                std::piecewise_construct, std::forward_as_tuple(key),
+                std::forward_as_tuple(std::piecewise_construct, std::forward_as_tuple(sub_model),
+                                      std::forward_as_tuple(_Type<T>(), key)));
+            if (declared.second) {
+                model.declare_key(key);
+            }
+        };
+        components().add(typeid(_Builder<T>), std::move(entry));
+    }
+
+    static void save_model(const Model& model, std::ostream& os, _SaveState& state) {
+        _SnapshotIO<std::uint64_t>::write(os, model.components.size());
+        for (auto& c : model.components) {
+            auto& entry = components().at(typeid(*c.second.builder), "Component " + c.first);
+            _SnapshotIO<std::string>::write(os, c.first);
+            write_name(os, state.components, entry.name);
+            entry.save(os, *c.second.builder);
+        }
+        _SnapshotIO<std::uint64_t>::write(os, model.composites.size());
+        for (auto& c : model.composites) {
+            auto& entry = components().at(typeid(*c.second.second.builder), "Composite " + c.first);
+            _SnapshotIO<std::string>::write(os, c.first);
+            write_name(os, state.components, entry.name);
+            save_model(*c.second.first, os, state);
+        }
+        _SnapshotIO<std::uint64_t>::write(os, model.operations.size());
+        for (auto& o : model.operations) {
+            if (o.args == nullptr) {
+                throw TinycompoException("<Snapshot::save> Operation of type " + o.type +
+                                         " has no stored arguments (eg, configure) and cannot be saved");
+            }
+            auto& entry = connectors().at(typeid(*o.args), "Operation " + o.type);
+            write_name(os, state.connectors, entry.name);
+            entry.save(os, *o.args);
+        }
+    }
+
+    static void load_model(Model& model, _SnapshotReader& is, _LoadState& state) {
+        auto nb_components = _SnapshotIO<std::uint64_t>::read(is);
+        for (std::uint64_t i = 0; i < nb_components; i++) {
+            auto key = _SnapshotIO<std::string>::read(is);
+            auto& entry = read_name(is, state.components, components());
+            if (entry.composite) {
+                throw TinycompoException("<Snapshot::load> Composite type " + entry.name + " used for component " + key);
+            }
+            entry.load(model, key, is);
+        }
+        auto nb_composites = _SnapshotIO<std::uint64_t>::read(is);
+        for (std::uint64_t i = 0; i < nb_composites; i++) {
+            auto key = _SnapshotIO<std::string>::read(is);
+            auto& entry = read_name(is, state.components, components());
+            if (!entry.composite) {
+                throw TinycompoException("<Snapshot::load> Component type " + entry.name + " used for composite " + key);
+            }
+            Model contents;
+            load_model(contents, is, state);
+            entry.load_composite(model, key, std::move(contents));
+        }
+        auto nb_operations = _SnapshotIO<std::uint64_t>::read(is);
+        for (std::uint64_t i = 0; i < nb_operations; i++) {
+            read_name(is, state.connectors, connectors()).load(model, is);
+        }
+    }
+
+  public:
+    template <class T, class... Args>  // T can be a composite (without Args)
+    static void register_component(const std::string& name) {
+        register_helper<T, Args...>(name, std::is_base_of<Composite, T>());
+    }
+
+    template <class C, class... Args>
+    static void register_connector(const std::string& name) {
+        _ConnectorEntry entry;
+        entry.name = name;
+        entry.save = [](std::ostream& os, const _AbstractArgs& args) {
+            _snapshot_write_tuple(os, static_cast<const _Args<C, Args...>&>(args).values,
+                                  typename _gens<sizeof...(Args)>::type());
+        };
+        entry.load = [](Model& model, _SnapshotReader& is) {
+            std::tuple<Args...> values{_SnapshotIO<Args>::read(is)...};
+            _ConnectorLoader<C, Args...>::load(model, std::move(values), typename _gens<sizeof...(Args)>::type());
+        };
+        connectors().add(typeid(_Args<C, Args...>), std::move(entry));
+    }
+
+    static void save(const Model& model, std::ostream& os) {
+        _SnapshotIO<std::string>::write(os, magic());
+        _SaveState state;
+        save_model(model, os, state);
+    }
+
+    static void save(const Model& model, const std::string& file_name) {
+        std::ofstream os(file_name, std::ios::binary);
+        save(model, os);
+    }
+
+    static Model load(std::istream& input) {
+        _SnapshotReader is(input);
+        std::string header;
+        try {
+            header = _SnapshotIO<std::string>::read(is);
+        } catch (...) {
+        }
+        if (header != magic()) {
+            throw TinycompoException("<Snapshot::load> Not a tinycompo snapshot");
+        }
+        Model model;
+        _LoadState state;
+        load_model(model, is, state);
+        return model;
+    }
+
+    static Model load(const std::string& file_name) {
+        std::ifstream is(file_name, std::ios::binary);
+        if (!is) {
+            throw TinycompoException("<Snapshot::load> Could not open file " + file_name);
+        }
+        return load(is);
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Checkpointable ~*~
+Interface for components whose state is saved by Assembly::checkpoint and reloaded by Assembly::restore (into an assembly
+built from the same model). write_state and read_state write and read values of the types supported by Snapshot, eg:
+    void save_state(std::ostream& os) const override { write_state(os, samples); }
+    void load_state(std::istream& is) override { read_state(is, samples); }
+===========================================================================================================================*/
+struct Checkpointable {
+    virtual ~Checkpointable() = default;
+    virtual void save_state(std::ostream& os) const = 0;
+    virtual void load_state(std::istream& is) = 0;
+};
+
+class _StreamReader {  // same interface as _SnapshotReader, directly on a stream
+    std::istream& is;
+
+  public:
+    explicit _StreamReader(std::istream& is) : is(is) {}
+
+    std::int64_t remaining() {  // number of bytes left in the stream, or -1 if the stream cannot tell (eg, a pipe)
+        auto here = is.tellg();
+        if (here == std::istream::pos_type(-1)) {
+            return -1;
+        }
+        is.seekg(0, std::ios::end);
+        auto end = is.tellg();
+        is.seekg(here);
+        return static_cast<std::int64_t>(end - here);
+    }
+
+    void read(void* data, std::size_t size) {
+        is.read(static_cast<char*>(data), size);
+        if (static_cast<std::size_t>(is.gcount()) != size) {
+            throw TinycompoException("<read_state> Unexpected end of state");
+        }
+    }
+};
+
+struct _MemoryBuffer : public std::streambuf {  // read-only stream buffer over existing memory (no copy)
+    _MemoryBuffer(const char* data, std::size_t size) {
+        auto begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+template <class T>
+void write_state(std::ostream& os, const T& value) {
+    _SnapshotIO<T>::write(os, value);
+}
+
+template <class T>
+void read_state(std::istream& is, T& value) {
+    _StreamReader reader(is);
+    value = _SnapshotIO<T>::read(reader);
+}
+
+/*
+=============================================================================================================================
+  ~*~ InstanceSet ~*~
+  An object representing a set of instantiated components. To be obtained via Assembly.
+===========================================================================================================================*/
+template <class C>
+class InstanceSet {
+    std::vector<Address> _names;
+    std::vector<C*> _pointers;
+
+  public:
+    void push_back(Address address, C* pointer) {
+        _names.push_back(address);
+        _pointers.push_back(pointer);
+    }
+
+    void combine(const InstanceSet<C>& other) {
+        _names.insert(_names.end(), other._names.begin(), other._names.end());
+        _pointers.insert(_pointers.end(), other._pointers.begin(), other._pointers.end());
+    }
+
+    const std::vector<Address>& names() const { return _names; }
+    const std::vector<C*>& pointers() const { return _pointers; }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Instance storage ~*~
+  By default, assemblies allocate each instance with new. An assembly can instead be given an _InstanceStorage providing
+  memory for (some of) its instances. The storage is reset at the beginning of each build, once previous instances are
+  destroyed, and place() returns memory for an instance or nullptr to fall back to new. place() is called concurrently by
+  parallel builds. Instances constructed in storage memory are only destroyed (not freed) by _InstanceDeleter.
+===========================================================================================================================*/
+struct _InstanceStorage {
+    virtual ~_InstanceStorage() = default;
+    virtual void reset(const Model& model) = 0;
+    virtual void* place(const std::string& key, const _ComponentBuilder& builder) = 0;
+};
+
+struct _InstanceDeleter {
+    bool owns_memory{true};
+    void operator()(Component* ptr) const {
+        if (owns_memory) {
+            delete ptr;
+        } else if (ptr != nullptr) {
+            ptr->~Component();
+        }
+    }
+};
+
+using _InstancePtr = std::unique_ptr<Component, _InstanceDeleter>;
+
+template <class T>  // one slot of type T per array index, in a single buffer
+class _ContiguousStorage : public _InstanceStorage {
+    using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+    std::unique_ptr<Slot[]> slots;
+    std::size_t nb_slots{0};
+
+  public:
+    void reset(const Model& model) override;  // implemented at the end
+
+    void* place(const std::string& key, const _ComponentBuilder& builder) override {
+        int index = _KeyTable::parse_index(key);
+        bool fits = index >= 0 and static_cast<std::size_t>(index) < nb_slots;
+        return (fits and builder.builder->type_info() == typeid(T)) ? &slots[index] : nullptr;
+    }
+
+    T* data() const { return reinterpret_cast<T*>(slots.get()); }
+};
+
+/* Monotonic arena: the memory for all instances declared by the model is allocated as one block by reset, and slots are
+handed out by bumping an atomic offset. Everything is freed at once by the next reset or when the storage is destroyed. */
+class _ArenaStorage : public _InstanceStorage {
+    struct alignas(16) Chunk {
+        char bytes[16];
+    };
+    std::unique_ptr<Chunk[]> block;
+    std::size_t capacity{0};  // in chunks
+    std::atomic<std::size_t> next{0};
+
+    static std::size_t nb_chunks(const _ComponentBuilder& builder) {
+        return (builder.builder->size() + sizeof(Chunk) - 1) / sizeof(Chunk);
+    }
+
+  public:
+    void reset(const Model& model) override;  // implemented at the end
+
+    void* place(const std::string&, const _ComponentBuilder& builder) override {
+        if (builder.builder->alignment() > alignof(Chunk)) {  // over-aligned types are allocated with new
+            return nullptr;
+        }
+        auto n = nb_chunks(builder);
+        auto offset = next.fetch_add(n);
+        return (offset + n <= capacity) ? &block[offset] : nullptr;
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ InstanceHandle ~*~
+  The result of resolving an address once with Assembly::handle. Dereferencing a handle is a plain pointer indirection (the
+  downcast is done at resolution time). Handles become invalid when the assembly that directly owns the instance (which can
+  be a sub-assembly) is re-instantiated or destroyed, which can be checked with valid(). The handle only shares a generation
+  counter with that assembly, so valid() can be called safely after the assembly is gone.
+===========================================================================================================================*/
+template <class T>
+class InstanceHandle {
+    std::weak_ptr<const std::size_t> owner_generation;  // generation counter of the assembly owning the instance
+    std::size_t generation{0};                          // value of the counter when the handle was created
+    T* pointer{nullptr};
+
+  public:
+    InstanceHandle() = default;
+    InstanceHandle(std::weak_ptr<const std::size_t> owner_generation, std::size_t generation, T* pointer)
+        : owner_generation(std::move(owner_generation)), generation(generation), pointer(pointer) {}
+
+    T& operator*() const { return *pointer; }
+    T* operator->() const { return pointer; }
+    T* get() const { return pointer; }
+
+    bool valid() const {
+        auto current = owner_generation.lock();
+        return current != nullptr and *current == generation;
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ BuildReport ~*~
+Records what happens during the build of an assembly (see Assembly::set_build_report): one event per component or composite
+construction (the construction of a composite includes the build of its contents), per operation and per lifecycle function
+call, with its wall time and the number of allocations it made. Allocations are only counted if TINYCOMPO_COUNT_ALLOCATIONS
+is defined before including tinycompo, and are -1 otherwise. Counting replaces the global operator new, which must be
+defined in exactly one translation unit of the program by also defining TINYCOMPO_IMPLEMENT_ALLOCATION_COUNTER there.
+Allocations made by other threads started by an event are not counted. Events can be printed as a table or exported in the
+Chrome trace event format (viewable in chrome://tracing or Perfetto).
+===========================================================================================================================*/
+inline std::int64_t& _allocation_count() {  // allocations made by the current thread (see TINYCOMPO_COUNT_ALLOCATIONS)
+    static thread_local std::int64_t count{0};
+    return count;
+}
+
+class BuildReport {
+  public:
+    struct Event {
+        std::string kind;    // construct, connect, after_construct or after_connect
+        std::string name;    // instance name or operation type
+        std::string detail;  // component type or operation neighbors
+        std::int64_t start_ns, duration_ns;
+        std::int64_t allocations;
+        int thread;
+    };
+
+  private:
+    using clock = std::chrono::steady_clock;
+    clock::time_point origin{clock::now()};
+    mutable std::mutex mutex;
+    std::vector<Event> _events;
+    std::map<std::thread::id, int> threads;
+
+    static std::string json_escape(const std::string& s) {
+        std::string result;
+        for (auto c : s) {
+            if (c == '"' or c == '\\') {
+                result += '\\';
+                result += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+  public:
+    template <class F>
+    void record(const std::string& kind, const std::string& name, const std::string& detail, F f) {
+        auto allocations = _allocation_count();
+        auto start = clock::now();
+        f();
+        auto end = clock::now();
+#ifdef TINYCOMPO_COUNT_ALLOCATIONS
+        allocations = _allocation_count() - allocations;
+#else
+        allocations = -1;
+#endif
+        std::lock_guard<std::mutex> lock(mutex);
+        auto thread = threads.emplace(std::this_thread::get_id(), static_cast<int>(threads.size())).first->second;
+        _events.push_back(Event{kind, name, detail,
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count(),
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), allocations,
+                                thread});
+    }
+
+    std::vector<Event> events() const {  // in order of completion
+        std::lock_guard<std::mutex> lock(mutex);
+        return _events;
+    }
+
+    std::vector<Event> slowest(std::size_t n) const {
+        auto result = events();
+        std::sort(result.begin(), result.end(),
+                  [](const Event& a, const Event& b) { return a.duration_ns > b.duration_ns; });
+        result.resize(std::min(n, result.size()));
+        return result;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        _events.clear();
+    }
+
+    void print(std::ostream& os = std::cout) const {  // one event per line, slowest first
+        for (auto& e : slowest(std::numeric_limits<std::size_t>::max())) {
+            os << e.kind << "\t" << e.name << "\t" << e.detail << "\t" << e.duration_ns << " ns\t";
+            os << ((e.allocations >= 0) ? std::to_string(e.allocations) : std::string("?")) << " allocations\n";
+        }
+    }
+
+    void to_chrome_trace(std::ostream& os) const {  // times in microseconds, with nanosecond digits
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os.setf(std::ios::fixed, std::ios::floatfield);  // the default 6 significant digits would round events after 1 s
+        os.precision(3);
+        os << "{\"traceEvents\":[";
+        bool first = true;
+        for (auto& e : events()) {
+            os << (first ? "\n" : ",\n") << "{\"name\":\"" << json_escape(e.name) << "\",\"cat\":\"" << e.kind
+               << "\",\"ph\":\"X\",\"ts\":" << e.start_ns / 1000.0 << ",\"dur\":" << e.duration_ns / 1000.0
+               << ",\"pid\":0,\"tid\":" << e.thread << ",\"args\":{\"detail\":\"" << json_escape(e.detail)
+               << "\",\"allocations\":" << e.allocations << "}}";
+            first = false;
+        }
+        os << "\n]}\n";
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    void to_chrome_trace(const std::string& file_name) const {
+        std::ofstream os(file_name);
+        to_chrome_trace(os);
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Assembly class ~*~
+===========================================================================================================================*/
+class Assembly : public Component {
+    std::unique_ptr<_InstanceStorage> storage;  // declared first so that it outlives instances
+    std::map<std::string, _InstancePtr> instances;
+    std::vector<Component*> indexed_instances;  // instances whose key is an array index, by index
+    // incremented by each build, shared with handles so that they can be checked after the assembly is destroyed
+    std::shared_ptr<std::size_t> generation{std::make_shared<std::size_t>(0)};
+    std::shared_ptr<const Model> internal_model{std::make_shared<const Model>()};  // shared with the parent's model
+
+    bool frozen{false};                                                // see freeze
+    std::unordered_map<Address, Component*, _AddressHash> flat_table;  // every address below this assembly when frozen
+    std::vector<std::pair<Address, Component*>> flat_components;       // components in all_addresses order when frozen
+
+    friend Composite;
+
+    int build_threads{1};  // number of threads used by build (1 means sequential build)
+    bool arena{false};     // whether instances are allocated in an arena (see use_arena)
+    bool lazy{false};      // whether instances are built on demand (see use_lazy_instantiation)
+    BuildReport* report{nullptr};  // see set_build_report
+
+    /* In lazy mode, top-level keys are partitioned into groups: two keys are in the same group if an operation has neighbors
+    in both. A group is built at once (construction, after_construct, its operations in model order, after_connect) the
+    first time one of its keys is accessed, which gives the same result as an eager build since operations from different
+    groups touch disjoint instances. */
+    struct _LazyGroup {
+        std::vector<std::string> keys;         // declared keys (components and composites)
+        std::vector<std::size_t> operations;  // indices in internal_model->operations
+        bool built{false};
+    };
+    bool lazy_build{false};  // whether the current build is lazy (some instances might not be built yet)
+    std::vector<_LazyGroup> lazy_groups;
+    std::unordered_map<std::string, std::size_t> lazy_group_of;
+
+    static const char* checkpoint_magic() { return "tinycompo-checkpoint-1"; }
+
+    void check_not_frozen(const std::string& function) const {
+        if (frozen) {
+            throw TinycompoException("<Assembly::" + function + "> Trying to modify a frozen assembly");
+        }
+    }
+
+    std::string instance_name(const std::string& key) const {
+        return get_name() + ((get_name() != "") ? "__" : "") + key;
+    }
+
+    _InstancePtr make_instance(const std::string& key, const _ComponentBuilder& builder) const {
+        void* place = (storage != nullptr) ? storage->place(key, builder) : nullptr;
+        if (place == nullptr) {
+            return _InstancePtr(builder.builder->construct());
+        }
+        _InstanceDeleter destroy_only;
+        destroy_only.owns_memory = false;
+        return _InstancePtr(builder.builder->construct_at(place), destroy_only);
+    }
+
+    void build() {
+        if (storage != nullptr) {
+            storage->reset(*internal_model);
+        }
+        lazy_build = lazy and prepare_lazy_build();
+        if (lazy_build) {
+            indexed_instances.assign(internal_model->components.size() + internal_model->composites.size(), nullptr);
+            ++*generation;
+            return;
+        }
+
+        // components do not know about each other at this point so they can be constructed concurrently
+        std::vector<const std::pair<const std::string, _ComponentBuilder>*> builders;
+        for (auto& c : internal_model->components) {
+            builders.push_back(&c);
+        }
+        std::vector<_InstancePtr> built(builders.size());
+        _parallel_for(builders.size(), build_threads, [&](std::size_t i) {
+            built[i] = construct_component(builders[i]->first, builders[i]->second);
+        });
+        for (std::size_t i = 0; i < builders.size(); i++) {
+            instances.emplace(builders[i]->first, std::move(built[i]));
+        }
+
+        // composites are built concurrently too, threads are split between them for their own build
+        std::vector<const std::pair<const std::string, Model::_CompositeDecl>*> composite_builders;
+        for (auto& c : internal_model->composites) {
+            composite_builders.push_back(&c);
+        }
+        std::vector<_InstancePtr> built_composites(composite_builders.size());
+        int sub_threads = std::max(1, build_threads / std::max(1, static_cast<int>(composite_builders.size())));
+        _parallel_for(composite_builders.size(), build_threads, [&](std::size_t i) {
+            built_composites[i] = make_composite(*composite_builders[i], sub_threads);
+        });
+        for (std::size_t i = 0; i < composite_builders.size(); i++) {
+            instances.emplace(composite_builders[i]->first, std::move(built_composites[i]));
+        }
+        index_instances();
+        ++*generation;
+
+        for (auto& i : instances) {
+            hook("after_construct", *i.second, &Component::after_construct);
+        }
+        if (build_threads > 1) {
+            connect_in_waves();
+        } else {
+            for (auto& o : internal_model->operations) {
+                connect_operation(o);
+            }
+        }
+        for (auto& i : instances) {
+            hook("after_connect", *i.second, &Component::after_connect);
+        }
+    }
+
+    _InstancePtr construct_component(const std::string& key, const _ComponentBuilder& builder) const {
+        _InstancePtr instance;
+        auto name = instance_name(key);
+        timed("construct", name, builder.type, [&]() { instance = make_instance(key, builder); });
+        instance->set_name(name);
+        return instance;
+    }
+
+    _InstancePtr make_composite(const std::pair<const std::string, Model::_CompositeDecl>& composite, int threads) const {
+        if (report == nullptr) {
+            return build_composite(composite, threads);
+        }
+        _InstancePtr instance;
+        timed("construct", instance_name(composite.first), composite.second.second.type,
+              [&]() { instance = build_composite(composite, threads); });
+        return instance;
+    }
+
+    void hook(const char* kind, Component& instance, void (Component::*f)()) const {  // calls a lifecycle function
+        if (report == nullptr) {
+            (instance.*f)();
+        } else {
+            timed(kind, instance.get_name(), "", [&]() { (instance.*f)(); });
+        }
+    }
+
+    void connect_operation(const _Operation& operation) {
+        if (report == nullptr) {
+            operation._connect(*this);
+            return;
+        }
+        std::string neighbors;
+        for (auto& n : operation.neighbors) {
+            neighbors += (neighbors.empty() ? "" : " ") + n.address + (n.port.empty() ? "" : "." + n.port);
+        }
+        timed("connect", operation.type, neighbors, [&]() { operation._connect(*this); });
+    }
+
+    template <class F>
+    void timed(const char* kind, const std::string& name, const std::string& detail, F f) const {
+        if (report == nullptr) {
+            f();
+        } else {
+            report->record(kind, name, detail, f);
+        }
+    }
+
+    _InstancePtr build_composite(const std::pair<const std::string, Model::_CompositeDecl>& composite, int threads) const {
+        auto instance = make_instance(composite.first, composite.second.second);
+        auto& ref = dynamic_cast<Assembly&>(*instance);
+        ref.set_name(instance_name(composite.first));
+        ref.build_threads = threads;
+        ref.report = report;
+        if (lazy and ref.storage == nullptr) {  // composites with their own storage (eg, FlatArray) stay eager
+            ref.lazy = true;
+        }
+        if (arena and ref.storage == nullptr) {
+            ref.use_arena();
+        }
+        ref.instantiate_shared(composite.second.first);  // the sub-model is shared, not copied
+        return instance;
+    }
+
+    void index_instance(const std::string& key, Component* instance) {
+        int index = _KeyTable::parse_index(key);
+        if (index >= 0 and static_cast<std::size_t>(index) < indexed_instances.size()) {
+            indexed_instances[index] = instance;
+        }
+    }
+
+    void index_instances() {
+        indexed_instances.assign(instances.size(), nullptr);
+        for (auto& i : instances) {
+            index_instance(i.first, i.second.get());
+        }
+    }
+
+    bool prepare_lazy_build() {  // computes lazy groups (see _LazyGroup), false if some operation has no neighbors
+        lazy_groups.clear();
+        lazy_group_of.clear();
+        std::unordered_map<std::string, std::size_t> ids;  // union-find over top-level keys
+        std::vector<std::size_t> parent;
+        auto id = [&](const std::string& key) {
+            auto it = ids.emplace(key, parent.size());
+            if (it.second) {
+                parent.push_back(parent.size());
+            }
+            return it.first->second;
+        };
+        auto find = [&](std::size_t i) {
+            while (parent[i] != i) {
+                i = parent[i] = parent[parent[i]];
+            }
+            return i;
+        };
+        for (auto& o : internal_model->operations) {
+            if (o.neighbors.empty()) {
+                return false;
+            }
+            auto first = id(Address(o.neighbors.front().address).first());
+            for (auto& n : o.neighbors) {
+                parent[find(id(Address(n.address).first()))] = find(first);
+            }
+        }
+
+        std::unordered_map<std::size_t, std::size_t> group_of_root;
+        auto group = [&](const std::string& key) -> _LazyGroup& {
+            auto it = group_of_root.emplace(find(id(key)), lazy_groups.size());
+            if (it.second) {
+                lazy_groups.emplace_back();
+            }
+            return lazy_groups[it.first->second];
+        };
+        auto declare = [&](const std::string& key) {
+            group(key).keys.push_back(key);
+            lazy_group_of[key] = group_of_root.at(find(id(key)));
+        };
+        for (auto& c : internal_model->components) {
+            declare(c.first);
+        }
+        for (auto& c : internal_model->composites) {
+            declare(c.first);
+        }
+        for (std::size_t i = 0; i < internal_model->operations.size(); i++) {
+            group(Address(internal_model->operations[i].neighbors.front().address).first()).operations.push_back(i);
+        }
+        return true;
+    }
+
+    void build_lazy_group(std::size_t g) {
+        auto& group = lazy_groups[g];
+        if (group.built) {
+            return;
+        }
+        group.built = true;  // before building since operations access instances of the group through at
+        std::vector<_InstancePtr> built(group.keys.size());
+        _parallel_for(group.keys.size(), build_threads, [&](std::size_t i) {
+            auto& key = group.keys[i];
+            auto c = internal_model->components.find(key);
+            if (c != internal_model->components.end()) {
+                built[i] = construct_component(key, c->second);
+            } else {
+                built[i] = make_composite(*internal_model->composites.find(key), 1);
+            }
+        });
+        std::vector<Component*> fresh;
+        for (std::size_t i = 0; i < built.size(); i++) {
+            fresh.push_back(built[i].get());
+            index_instance(group.keys[i], built[i].get());
+            instances.emplace(group.keys[i], std::move(built[i]));
+        }
+        for (auto i : fresh) {
+            hook("after_construct", *i, &Component::after_construct);
+        }
+        for (auto o : group.operations) {
+            connect_operation(internal_model->operations[o]);
+        }
+        for (auto i : fresh) {
+            hook("after_connect", *i, &Component::after_connect);
+        }
+    }
+
+    void materialize(const std::string& key) const {  // lazy mode: builds key (and its group) if needed
+        auto it = lazy_group_of.find(key);
+        if (it != lazy_group_of.end() and !lazy_groups[it->second].built) {
+            const_cast<Assembly*>(this)->build_lazy_group(it->second);
+        }
+    }
+
+    void materialize_all() const {  // lazy mode: builds everything that has not been built yet
+        if (lazy_build) {
+            for (std::size_t g = 0; g < lazy_groups.size(); g++) {
+                const_cast<Assembly*>(this)->build_lazy_group(g);
+            }
+        }
+    }
+
+    template <class T>
+    T& local_at(const std::string& key_name) const {  // instance from this assembly by key
+        auto it = instances.find(key_name);
+        if (it == instances.end() and lazy_build) {
+            materialize(key_name);
+            it = instances.find(key_name);
+        }
+        if (it == instances.end()) {
+            auto existing = lazy_build ? TinycompoDebug::list(internal_model->components) +
+                                             TinycompoDebug::list(internal_model->composites)
+                                       : TinycompoDebug::list(instances);
+            throw TinycompoException("<Assembly::at> Trying to access incorrect address. Address " + key_name +
+                                     " does not exist. Existing addresses are:\n" + existing);
+        }
+        return dynamic_cast<T&>(*(it->second.get()));
+    }
+
+    template <class T>
+    T& local_at(int index) const {
+        if (index >= 0 and static_cast<std::size_t>(index) < indexed_instances.size() and
+            indexed_instances[index] != nullptr) {
+            return dynamic_cast<T&>(*indexed_instances[index]);
+        }
+        return local_at<T>(std::to_string(index));
+    }
+
+    template <class T>
+    T& local_at(const Address& address, std::size_t i) const {  // i-th key of address, using the index if possible
+        int index = address.index(i);
+        return (index >= 0) ? local_at<T>(index) : local_at<T>(address.key(i));
+    }
+
+    /* Operations are grouped in waves: an operation goes in the wave following the last wave containing an earlier
+    operation that has a neighbor in common with it (neighbors being compared by their top-level key). Operations from the
+    same wave touch disjoint sets of instances and are run concurrently, while the relative order of operations touching the
+    same instance is preserved. Operations without neighbors might touch anything and thus get a wave of their own. */
+    void connect_in_waves() {
+        auto& operations = internal_model->operations;
+        std::vector<std::vector<const _Operation*>> waves;
+        std::map<std::string, std::size_t> next_wave;  // first wave in which an instance is free to be used
+        std::size_t barrier = 0;                       // first wave after the last operation without neighbors
+        for (auto& o : operations) {
+            std::size_t wave = barrier;
+            if (o.neighbors.empty()) {
+                wave = waves.size();
+                barrier = wave + 1;
+            }
+            for (auto& n : o.neighbors) {
+                auto it = next_wave.find(Address(n.address).first());
+                if (it != next_wave.end()) {
+                    wave = std::max(wave, it->second);
+                }
+            }
+            for (auto& n : o.neighbors) {
+                next_wave[Address(n.address).first()] = wave + 1;
+            }
+            if (wave >= waves.size()) {
+                waves.resize(wave + 1);
+            }
+            waves[wave].push_back(&o);
+        }
+        for (auto& wave : waves) {
+            _parallel_for(wave.size(), build_threads, [&](std::size_t i) { connect_operation(*wave[i]); });
+        }
+    }
+
+    /* Incremental update (see update). The plan compares the current model with the new one: an address in dirty means the
+    corresponding instance (and everything below it) is destroyed and, if still in the model, recreated. Operations are
+    replayed if they are new or if one of their neighbors is (or contains) a dirty address. A replayed operation must apply
+    to fresh instances, so the instances it modifies (see _Operation::mutated_neighbors) become dirty in turn, until a
+    fixpoint is reached. Kept composites (same key and same declaration in both models) are planned recursively; forced holds
+    the addresses the parent requires to be recreated inside them. A kept composite with an instance storage (eg, FlatArray
+    or arena) is recreated as a whole if any of its instances is, since its storage is laid out once for its whole model.
+    current is the assembly instantiating old_model (nullptr if unknown), used to find which composites have a storage. */
+    struct _UpdatePlan {
+        bool full{false};  // model contains operations that cannot be analyzed: rebuild everything
+        std::set<Address> dirty;
+        std::vector<bool> replay;                          // per operation of the new model
+        std::map<std::string, std::set<Address>> forced;   // per kept composite
+        std::map<std::string, bool> kept;                  // kept composites, and whether their assembly must be updated
+        bool changed() const { return full or !dirty.empty() or std::count(replay.begin(), replay.end(), true) > 0; }
+    };
+
+    static bool covered(const std::set<Address>& dirty, const Address& address) {  // address or an ancestor is dirty
+        Address prefix;
+        for (std::size_t i = 0; i < address.size(); i++) {
+            prefix = Address(prefix, address.key(i));
+            if (dirty.count(prefix) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool touched(const std::set<Address>& dirty, const Address& address) {  // covered or with a dirty descendant
+        auto it = dirty.lower_bound(address);  // descendants of address directly follow it in address order
+        return covered(dirty, address) or (it != dirty.end() and address.is_ancestor(*it));
+    }
+
+    static std::string operation_key(const _Operation& operation) {  // to look for operations with the same neighbors
+        std::string result = operation.type;
+        for (auto& n : operation.neighbors) {
+            result += "|" + n.address + "." + n.port;
+        }
+        return result;
+    }
+
+    static _UpdatePlan plan_update(const Model& old_model, const Model& new_model, const std::set<Address>& forced,
+                                   const Assembly* current) {
+        _UpdatePlan plan;
+        for (auto& o : new_model.operations) {
+            plan.full = plan.full or o.neighbors.empty();
+        }
+        for (auto& o : old_model.operations) {
+            plan.full = plan.full or o.neighbors.empty();
+        }
+        if (plan.full) {
+            return plan;
+        }
+
+        for (auto& c : new_model.composites) {
+            auto it = old_model.composites.find(c.first);
+            if (it != old_model.composites.end() and it->second.second.same_as(c.second.second)) {
+                plan.kept[c.first] = false;
+            }
+        }
+        std::set<std::string> to_plan;  // kept composites whose plan has to be (re)computed
+        auto mark = [&](const Address& address) {
+            if (covered(plan.dirty, address)) {
+                return;
+            }
+            if (address.size() > 1 and plan.kept.count(address.first()) != 0) {
+                if (plan.forced[address.first()].insert(address.rest()).second) {
+                    to_plan.insert(address.first());
+                }
+            } else {
+                plan.dirty.insert(Address(address.first()));
+            }
+        };
+
+        // changes in declarations
+        for (auto& a : forced) {
+            mark(a);
+        }
+        for (auto& c : old_model.components) {
+            auto it = new_model.components.find(c.first);
+            if (it == new_model.components.end() or !it->second.same_as(c.second)) {
+                mark(Address(c.first));
+            }
+        }
+        for (auto& c : new_model.components) {
+            if (old_model.components.count(c.first) == 0) {
+                mark(Address(c.first));
+            }
+        }
+        for (auto& c : old_model.composites) {
+            if (plan.kept.count(c.first) == 0) {
+                mark(Address(c.first));
+            }
+        }
+        for (auto& c : new_model.composites) {
+            if (plan.kept.count(c.first) == 0) {
+                mark(Address(c.first));
+            }
+        }
+        for (auto& c : plan.kept) {
+            to_plan.insert(c.first);
+        }
+
+        // matching operations of the old and new models; the effects of removed operations are undone by recreation
+        std::unordered_multimap<std::string, std::size_t> old_operations;
+        for (std::size_t i = 0; i < old_model.operations.size(); i++) {
+            old_operations.emplace(operation_key(old_model.operations[i]), i);
+        }
+        std::vector<bool> matched(old_model.operations.size(), false);
+        std::vector<bool> is_new(new_model.operations.size(), true);
+        for (std::size_t i = 0; i < new_model.operations.size(); i++) {
+            auto range = old_operations.equal_range(operation_key(new_model.operations[i]));
+            for (auto it = range.first; it != range.second and is_new[i]; ++it) {
+                if (!matched[it->second] and old_model.operations[it->second].same_as(new_model.operations[i])) {
+                    matched[it->second] = true;
+                    is_new[i] = false;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < old_model.operations.size(); i++) {
+            if (!matched[i]) {
+                for (auto& a : old_model.operations[i].mutated_neighbors()) {
+                    mark(a);
+                }
+            }
+        }
+
+        // propagation until fixpoint
+        plan.replay.assign(new_model.operations.size(), false);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            auto planning = std::move(to_plan);
+            to_plan.clear();
+            for (auto& key : planning) {
+                const Assembly* sub_assembly = nullptr;
+                if (current != nullptr) {
+                    auto it = current->instances.find(key);
+                    sub_assembly = (it != current->instances.end()) ? dynamic_cast<Assembly*>(it->second.get()) : nullptr;
+                }
+                auto sub_plan = plan_update(*old_model.composites.at(key).first, *new_model.composites.at(key).first,
+                                            plan.forced[key], sub_assembly);
+                plan.kept[key] = sub_plan.changed();
+                bool has_storage = sub_assembly != nullptr and sub_assembly->storage != nullptr;
+                if (sub_plan.full or (has_storage and !sub_plan.dirty.empty())) {
+                    mark(Address(key));
+                }
+                for (auto& a : sub_plan.dirty) {
+                    Address full_address(Address(key), a);
+                    if (!covered(plan.dirty, full_address)) {
+                        plan.dirty.insert(full_address);
+                        changed = true;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < new_model.operations.size(); i++) {
+                if (plan.replay[i]) {
+                    continue;
+                }
+                auto& operation = new_model.operations[i];
+                bool replay = is_new[i];
+                for (auto& n : operation.neighbors) {
+                    replay = replay or touched(plan.dirty, Address(n.address));
+                }
+                if (replay) {
+                    plan.replay[i] = true;
+                    changed = true;
+                    for (auto& a : operation.mutated_neighbors()) {
+                        mark(a);
+                    }
+                }
+            }
+            changed = changed or !to_plan.empty();
+        }
+        return plan;
+    }
+
+    void instantiate_shared(std::shared_ptr<const Model> model) {  // model is immutable, so it can be shared without copy
+        internal_model = std::move(model);
+        instantiate();
+    }
+
+    void update_from(std::shared_ptr<const Model> model, const std::set<Address>& forced) {
+        materialize_all();
+        lazy_build = false;
+        auto plan = plan_update(*internal_model, *model, forced, this);
+        if (plan.full or (storage != nullptr and !plan.dirty.empty())) {
+            instantiate_shared(std::move(model));
+            return;
+        }
+
+        for (auto& a : plan.dirty) {
+            if (a.size() == 1) {
+                instances.erase(a.first());
+            }
+        }
+        internal_model = std::move(model);
+
+        std::vector<Component*> fresh;
+        for (auto& c : internal_model->components) {
+            if (instances.count(c.first) == 0) {
+                auto instance = construct_component(c.first, c.second);
+                fresh.push_back(instance.get());
+                instances.emplace(c.first, std::move(instance));
+            }
+        }
+        for (auto& c : internal_model->composites) {
+            auto it = instances.find(c.first);
+            if (it == instances.end()) {
+                auto instance = make_composite(c, build_threads);
+                fresh.push_back(instance.get());
+                instances.emplace(c.first, std::move(instance));
+            } else if (plan.kept.at(c.first)) {
+                dynamic_cast<Assembly&>(*it->second).update_from(c.second.first, plan.forced[c.first]);
+            } else {
+                dynamic_cast<Assembly&>(*it->second).internal_model = c.second.first;
+            }
+        }
+        index_instances();
+        if (!plan.dirty.empty()) {
+            ++*generation;
+        }
+
+        for (auto i : fresh) {
+            hook("after_construct", *i, &Component::after_construct);
+        }
+        for (std::size_t i = 0; i < internal_model->operations.size(); i++) {
+            if (plan.replay[i]) {
+                connect_operation(internal_model->operations[i]);
+            }
+        }
+        for (auto i : fresh) {
+            hook("after_connect", *i, &Component::after_connect);
+        }
+    }
+
+  protected:
+    void set_storage(std::unique_ptr<_InstanceStorage> new_storage) {  // only valid before instantiation
+        if (!instances.empty()) {
+            throw TinycompoException("Trying to change the instance storage of an instantiated assembly");
         }
-        acc_composites_ref<std::vector<Address>>(result, [](std::vector<Address>& acc, Introspector& i, Address context) {
-            auto tmp = i.deep_components(context);
-            acc.insert(acc.end(), tmp.begin(), tmp.end());
-        });
-        return result;
+        storage = std::move(new_storage);
     }
 
-    std::vector<std::pair<PortAddress, Address>> directed_binops(Address prefix = Address()) const {
-        std::vector<std::pair<PortAddress, Address>> result;
+  public:
+    Assembly() = default;
 
-        for (auto operation : m.operations) {
-            auto& n = operation.neighbors;
-            if (n.size() == 2 and n.at(0).port != "" and n.at(1).port == "") {
-                PortAddress origin(n.at(0).port, Address(prefix, Address(n.at(0).address)));
-                Address dest(prefix, Address(n.at(1).address));
-                result.emplace_back(origin, dest);
-            }
-        }
-        return result;
+    explicit Assembly(const Model& model, const std::string& name = "", int build_threads = 1)
+        : internal_model(std::make_shared<const Model>(model)), build_threads(build_threads) {
+        set_name(name);
+        build();
     }
 
-    std::vector<std::pair<PortAddress, Address>> deep_directed_binops(Address prefix = Address()) const {
-        using t = std::vector<std::pair<PortAddress, Address>>;
-        auto result = directed_binops(prefix);
-        acc_composites_ref<t>(result, [](t& acc, Introspector& i, Address context) {
-            auto tmp = i.deep_directed_binops(context);
-            acc.insert(acc.end(), tmp.begin(), tmp.end());
-        });
-        return result;
+    explicit Assembly(Model&& model, const std::string& name = "", int build_threads = 1)
+        : internal_model(std::make_shared<const Model>(std::move(model))), build_threads(build_threads) {
+        set_name(name);
+        build();
     }
-};
 
-/*
-=============================================================================================================================
-  ~*~ InstanceSet ~*~
-  An object representing a set of instantiated components. To be obtained via Assembly.
-===========================================================================================================================*/
-template <class C>
-class InstanceSet {
-    std::vector<Address> _names;
-    std::vector<C*> _pointers;
+    /* Sets the number of threads used by subsequent calls to instantiate (the constructor takes it as parameter too).
+    With more than one thread, component constructors run concurrently and so do connectors that do not share instances
+    (see connect_in_waves), so they should not rely on unsynchronized global state. Lifecycle methods (after_construct and
+    after_connect) are always called sequentially. Sub-composites inherit a share of the threads. */
+    void set_build_threads(int n) {
+        check_not_frozen("set_build_threads");
+        build_threads = std::max(1, n);
+    }
 
-  public:
-    void push_back(Address address, C* pointer) {
-        _names.push_back(address);
-        _pointers.push_back(pointer);
+    /* Makes subsequent instantiations lazy: instead of building everything, instances are built on first access (through at
+    or by a connector), along with everything that is connected to them (see _LazyGroup). Sub-composites are lazy too,
+    except the ones with a storage of their own. This saves time and memory for large models of which only a part is used,
+    but lazy accesses modify the assembly, so they must not happen concurrently (freeze builds everything first). Falls back
+    to an eager build if the model contains operations without neighbors since their effects cannot be tracked. */
+    void use_lazy_instantiation() {
+        check_not_frozen("use_lazy_instantiation");
+        lazy = true;
     }
 
-    void combine(const InstanceSet<C>& other) {
-        _names.insert(_names.end(), other._names.begin(), other._names.end());
-        _pointers.insert(_pointers.end(), other._pointers.begin(), other._pointers.end());
+    bool is_built(const std::string& key) const {  // whether key has been instantiated (always true if not lazy)
+        return instances.count(key) != 0;
     }
 
-    const std::vector<Address>& names() const { return _names; }
-    const std::vector<C*>& pointers() const { return _pointers; }
-};
+    /* Makes the assembly allocate its instances (and those of its sub-composites which do not have a storage of their own,
+    such as FlatArray) in a monotonic arena: one block per assembly, sized from the model at each build and released at once
+    when the assembly is re-instantiated or destroyed. Must be called before instantiation, eg:
+        Assembly assembly;
+        assembly.use_arena();
+        assembly.instantiate_from(model); */
+    void use_arena() {
+        check_not_frozen("use_arena");
+        set_storage(std::unique_ptr<_InstanceStorage>(new _ArenaStorage()));
+        arena = true;
+    }
 
-/*
-=============================================================================================================================
-  ~*~ Assembly class ~*~
-===========================================================================================================================*/
-class Assembly : public Component {
-    std::map<std::string, std::unique_ptr<Component>> instances;
-    Model internal_model;
+    /* Records the events of subsequent builds (including lazy builds and updates) and of the builds of sub-composites in
+    report, which must outlive the builds (see BuildReport), eg:
+        BuildReport report;
+        Assembly assembly;
+        assembly.set_build_report(&report);
+        assembly.instantiate_from(model);
+        report.to_chrome_trace("build.json");
+    A null pointer disables recording. */
+    void set_build_report(BuildReport* build_report) { report = build_report; }
+
+    void instantiate_from(const Model& model) {
+        check_not_frozen("instantiate_from");
+        instantiate_shared(std::make_shared<const Model>(model));
+    }
 
-    friend Composite;
+    void instantiate_from(Model&& model) {
+        check_not_frozen("instantiate_from");
+        instantiate_shared(std::make_shared<const Model>(std::move(model)));
+    }
 
-    void build() {
-        for (auto& c : internal_model.components) {
-            instances.emplace(c.first, std::unique_ptr<Component>(c.second._constructor()));
-            std::stringstream ss;
-            ss << get_name() << ((get_name() != "") ? "__" : "") << c.first;
-            instances.at(c.first).get()->set_name(ss.str());
-        }
-        for (auto& c : internal_model.composites) {
-            std::stringstream ss;
-            ss << get_name() << ((get_name() != "") ? "__" : "") << c.first;
-            auto it = instances.emplace(c.first, std::unique_ptr<Component>(c.second.second._constructor())).first;
-            auto& ref = dynamic_cast<Assembly&>(*(*it).second.get());
-            ref.set_name(ss.str());
-            ref.instantiate_from(c.second.first);
+    void instantiate() {
+        check_not_frozen("instantiate");
+        instances.clear();
+        build();
+    }
+
+    /* Brings an instantiated assembly in line with model while only destroying and recreating the instances that changed
+    since the last instantiation (as well as the users of changed instances, and the instances modified by new or removed
+    operations, see plan_update). Declarations are considered unchanged if they have the same type and equal arguments, or if
+    they were copied from the current model, eg:
+        Model model2 = assembly.get_model();
+        model2.component<MyCompo>("new_compo");
+        assembly.update(model2);
+    Handles are invalidated if any instance was destroyed. Falls back to a complete rebuild if one of the models contains
+    operations without neighbors since their effects cannot be tracked. Assemblies and composites with an instance storage
+    (see use_arena and FlatArray) are rebuilt completely as soon as one of their instances changes. */
+    void update(const Model& model) {
+        check_not_frozen("update");
+        if (&model == internal_model.get()) {
+            throw TinycompoException("<Assembly::update> Trying to update an assembly from its own model (use a copy)");
+        }
+        update_from(std::make_shared<const Model>(model), std::set<Address>());
+    }
+
+    /* Makes the assembly (and its sub-composites) immutable: instantiate, update and other functions modifying the set of
+    instances throw until unfreeze is called. In exchange, every address below the assembly is resolved with a single lookup
+    in a flat table, and lookup and introspection functions (at, handle, get_all, derives_from, size, print, as well as
+    Component::get on instances) only read immutable data, so they can be called from many threads at once without locks.
+    Calling ports of instances (eg, through call) is not covered: it is up to the components to be thread-safe. */
+    void freeze() {
+        if (frozen) {
+            return;
         }
+        materialize_all();
+        flat_table.clear();
         for (auto& i : instances) {
-            i.second->after_construct();
+            Address key(i.first);
+            flat_table.emplace(key, i.second.get());
+            auto sub_assembly = dynamic_cast<Assembly*>(i.second.get());
+            if (sub_assembly != nullptr) {
+                sub_assembly->freeze();
+                for (auto& sub : sub_assembly->flat_table) {
+                    flat_table.emplace(Address(key, sub.first), sub.second);
+                }
+            }
+        }
+        flat_components.clear();  // same order as Model::all_addresses
+        for (auto& c : internal_model->components) {
+            flat_components.emplace_back(Address(c.first), instances.at(c.first).get());
         }
-        for (auto& o : internal_model.operations) {
-            o._connect(*this);
+        for (auto& c : internal_model->composites) {
+            for (auto& sub : at<Assembly>(c.first).flat_components) {
+                flat_components.emplace_back(Address(c.first, sub.first), sub.second);
+            }
         }
+        frozen = true;
+    }
+
+    void unfreeze() {  // must not be called while other threads use the assembly
+        frozen = false;
+        flat_table.clear();
+        flat_components.clear();
         for (auto& i : instances) {
-            i.second->after_connect();
+            auto sub_assembly = dynamic_cast<Assembly*>(i.second.get());
+            if (sub_assembly != nullptr) {
+                sub_assembly->unfreeze();
+            }
         }
     }
 
-  public:
-    Assembly() : internal_model(Model()) {}
+    bool is_frozen() const { return frozen; }
+
+    /* Writes the state of every Checkpointable component below the assembly (see Checkpointable) to os, as a header with
+    the address, offset and size of each state followed by the states themselves. States are serialized concurrently (using
+    the build threads, see set_build_threads), so save_state should not rely on unsynchronized global state. */
+    void checkpoint(std::ostream& os) const {
+        auto checkpointables = get_all<Checkpointable>();
+        auto& pointers = checkpointables.pointers();
+        std::vector<std::string> states(pointers.size());
+        _parallel_for(pointers.size(), build_threads, [&](std::size_t i) {
+            std::ostringstream ss;
+            pointers[i]->save_state(ss);
+            states[i] = ss.str();
+        });
 
-    explicit Assembly(Model& model, const std::string& name = "") : internal_model(model) {
-        set_name(name);
-        build();
+        _SnapshotIO<std::string>::write(os, checkpoint_magic());
+        _SnapshotIO<std::uint64_t>::write(os, states.size());
+        std::uint64_t offset = 0;
+        for (std::size_t i = 0; i < states.size(); i++) {
+            _SnapshotIO<std::string>::write(os, checkpointables.names()[i].to_string());
+            _SnapshotIO<std::uint64_t>::write(os, offset);
+            _SnapshotIO<std::uint64_t>::write(os, states[i].size());
+            offset += states[i].size();
+        }
+        for (auto& state : states) {
+            os.write(state.data(), state.size());
+        }
+        if (!os) {
+            throw TinycompoException("<Assembly::checkpoint> Could not write checkpoint");
+        }
     }
 
-    void instantiate_from(Model model) {
-        internal_model = model;
-        instantiate();
+    void checkpoint(const std::string& file_name) const {
+        std::ofstream os(file_name, std::ios::binary);
+        checkpoint(os);
     }
 
-    void instantiate() {
-        instances.clear();
-        build();
+    /* Reloads the state of every Checkpointable component from a checkpoint of an assembly built from the same model.
+    States are loaded concurrently (using the build threads). Throws if the checkpointable components of the assembly do not
+    match the ones in the checkpoint. */
+    void restore(std::istream& is) {
+        _StreamReader reader(is);
+        std::string magic;
+        try {
+            magic = _SnapshotIO<std::string>::read(reader);
+        } catch (...) {
+        }
+        if (magic != checkpoint_magic()) {
+            throw TinycompoException("<Assembly::restore> Not a tinycompo checkpoint");
+        }
+        auto nb_states = _SnapshotIO<std::uint64_t>::read(reader);
+        std::unordered_map<std::string, std::pair<std::uint64_t, std::uint64_t>> offsets;  // offset and size by address
+        std::uint64_t total = 0;
+        for (std::uint64_t i = 0; i < nb_states; i++) {
+            auto address = _SnapshotIO<std::string>::read(reader);
+            auto offset = _SnapshotIO<std::uint64_t>::read(reader);
+            auto size = _SnapshotIO<std::uint64_t>::read(reader);
+            offsets[address] = std::make_pair(offset, size);
+            total = std::max(total, offset + size);
+        }
+        auto available = reader.remaining();
+        if (available >= 0 and total > static_cast<std::uint64_t>(available)) {
+            throw TinycompoException("<Assembly::restore> Checkpoint is truncated or corrupted (states take " +
+                                     std::to_string(total) + " bytes, " + std::to_string(available) + " available)");
+        }
+        std::string data;
+        char chunk[4096];
+        while (data.size() < total) {  // bounded chunks in case the size of the stream is unknown
+            auto n = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(chunk), total - data.size()));
+            reader.read(chunk, n);
+            data.append(chunk, n);
+        }
+
+        auto checkpointables = get_all<Checkpointable>();
+        auto& pointers = checkpointables.pointers();
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> states;
+        for (auto& name : checkpointables.names()) {
+            auto it = offsets.find(name.to_string());
+            if (it == offsets.end()) {
+                throw TinycompoException("<Assembly::restore> Component " + name.to_string() +
+                                         " has no state in checkpoint");
+            }
+            states.push_back(it->second);
+        }
+        if (states.size() != nb_states) {
+            throw TinycompoException("<Assembly::restore> Checkpoint contains states of components that do not exist");
+        }
+        _parallel_for(pointers.size(), build_threads, [&](std::size_t i) {
+            _MemoryBuffer buffer(data.data() + states[i].first, states[i].second);
+            std::istream ss(&buffer);
+            pointers[i]->load_state(ss);
+        });
+    }
+
+    void restore(const std::string& file_name) {
+        std::ifstream is(file_name, std::ios::binary);
+        if (!is) {
+            throw TinycompoException("<Assembly::restore> Could not open file " + file_name);
+        }
+        restore(is);
     }
 
     std::string debug() const override {
@@ -1097,7 +3798,9 @@ class Assembly : public Component {
         return ss.str();
     }
 
-    std::size_t size() const { return instances.size(); }
+    std::size_t size() const {
+        return lazy_build ? internal_model->components.size() + internal_model->composites.size() : instances.size();
+    }
 
     template <class C>
     bool derives_from(const Address& address) const {
@@ -1109,22 +3812,40 @@ class Assembly : public Component {
 
     template <class T = Component, class Key>
     T& at(Key key) const {
-        std::string key_name = key_to_string(key);
-        try {
-            return dynamic_cast<T&>(*(instances.at(key_name).get()));
-        } catch (std::out_of_range) {
-            throw TinycompoException("<Assembly::at> Trying to access incorrect address. Address " + key_name +
-                                     " does not exist. Existing addresses are:\n" + TinycompoDebug::list(instances));
+        return local_at<T>(key_to_string(key));
+    }
+
+    template <class T = Component>
+    T& at(int key) const {  // array elements: constant time, no conversion to string
+        return local_at<T>(key);
+    }
+
+    template <class T = Component>
+    T& at(const Address& address) const {  // walks down composites without building intermediate addresses
+        if (frozen) {
+            auto it = flat_table.find(address);
+            if (it != flat_table.end()) {
+                return dynamic_cast<T&>(*it->second);
+            }
+        }
+        if (address.size() == 0) {
+            return local_at<T>(std::string(""));
         }
+        const Assembly* current = this;
+        for (std::size_t i = 0; i + 1 < address.size(); i++) {
+            current = &current->local_at<Assembly>(address, i);
+        }
+        return current->local_at<T>(address, address.size() - 1);
     }
 
     template <class T = Component>
-    T& at(const Address& address) const {
-        if (!address.is_composite()) {
-            return at<T>(address.first());
-        } else {
-            return at<Assembly>(address.first()).template at<T>(address.rest());
+    InstanceHandle<T> handle(const Address& address) const {  // resolves address once, see InstanceHandle
+        const Assembly* owner = this;
+        for (std::size_t i = 0; i + 1 < address.size(); i++) {
+            owner = &owner->local_at<Assembly>(address, i);
         }
+        auto& target = at<T>(address);
+        return InstanceHandle<T>(owner->generation, *owner->generation, &target);
     }
 
     template <class T = Component>
@@ -1133,9 +3854,10 @@ class Assembly : public Component {
         return *compo_ref.get<T>(port_address.prop);
     }
 
-    Model& get_model() { return internal_model; }
+    const Model& get_model() const { return *internal_model; }
 
     void print(std::ostream& os = std::cout) const {
+        materialize_all();
         for (auto& i : instances) {
             os << i.first << ": " << i.second->debug() << std::endl;
         }
@@ -1143,12 +3865,14 @@ class Assembly : public Component {
 
     template <class... Args>
     void call(const PortAddress& port, Args... args) const {
-        at(port.address).set(port.prop, std::forward<Args>(args)...);
+        _PortCallTimer timer;  // the component lookup counts as framework overhead
+        at(port.address).template set_port<Args...>(timer, port.prop, std::forward<Args>(args)...);
     }
 
     template <class Key, class... Args>
     void call(const Key& key, const std::string& prop, Args... args) const {
-        at(key).set(prop, std::forward<Args>(args)...);
+        _PortCallTimer timer;
+        at(key).template set_port<Args...>(timer, prop, std::forward<Args>(args)...);
     }
 
     template <class Interface>
@@ -1164,9 +3888,18 @@ class Assembly : public Component {
     }
 
     template <class T = Component>
-    InstanceSet<T> get_all_helper(const Address parent = Address()) {
+    InstanceSet<T> get_all_helper(const Address parent = Address()) const {
         InstanceSet<T> result;
-        auto all_addresses = internal_model.all_addresses();
+        if (frozen) {
+            for (auto& c : flat_components) {
+                auto ptr = dynamic_cast<T*>(c.second);
+                if (ptr != nullptr) {
+                    result.push_back(Address(parent, c.first), ptr);
+                }
+            }
+            return result;
+        }
+        auto all_addresses = internal_model->all_addresses();
         for (auto&& address : all_addresses) {
             auto ptr = dynamic_cast<T*>(&at<Component>(address));
             if (ptr != nullptr) {
@@ -1177,12 +3910,12 @@ class Assembly : public Component {
     }
 
     template <class T = Component>
-    InstanceSet<T> get_all() {
+    InstanceSet<T> get_all() const {
         return get_all_helper<T>(Address());
     }
 
     template <class T>
-    InstanceSet<T> get_all(std::set<Address> composites_and_components, const Address& point_of_view = Address()) {
+    InstanceSet<T> get_all(std::set<Address> composites_and_components, const Address& point_of_view = Address()) const {
         InstanceSet<T> result;
         for (auto&& compo : composites_and_components) {
             if (is_composite(compo)) {
@@ -1195,7 +3928,7 @@ class Assembly : public Component {
     }
 
     template <class T>
-    InstanceSet<T> get_all(const Address& composite, const Address& point_of_view = Address("invalid")) {
+    InstanceSet<T> get_all(const Address& composite, const Address& point_of_view = Address("invalid")) const {
         Address pov = (point_of_view == Address("invalid")) ? composite : point_of_view;
         if (composite == Address()) {
             return get_all_helper<T>();
@@ -1219,7 +3952,7 @@ template <class C, class... Args>
 void instantiate_composite(C& c, Args&&... args) {
     Model m;
     C::contents(m, std::forward<Args>(args)...);
-    c.instantiate_from(m);
+    c.instantiate_from(std::move(m));
     c.after_construct();
 }
 
@@ -1250,6 +3983,36 @@ struct Use {
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ StaticUse class ~*~
+Binds a user port to a provider whose concrete type is known when declaring the model, so that calls from the user to the
+provider are resolved at compile time. The provider is declared as Sealed<Provider>, a final subclass of Provider, and the
+user port receives a Sealed<Provider>*: since the class is final, calls through the pointer are dispatched statically (and
+can be inlined) even if Provider's methods are virtual. Neither Provider nor the user need to be rewritten, as long as the
+user is templated on its pointer type, eg:
+    model.component<Sealed<RandInt>>("provider");
+    model.component<User<Sealed<RandInt>>>("user");
+    model.connect<StaticUse<RandInt>>(PortAddress("ptr", "user"), Address("provider"));
+===========================================================================================================================*/
+template <class Provider>
+struct Sealed final : public Provider {
+    using Provider::Provider;
+};
+
+template <class Provider>
+struct StaticUse {
+    static void _connect(Assembly& assembly, PortAddress user, Address provider) {
+        auto& ref_user = assembly.at(user.address);
+        auto ptr_provider = dynamic_cast<Sealed<Provider>*>(&assembly.at(provider));
+        if (ptr_provider == nullptr) {
+            throw TinycompoException("<StaticUse::_connect> Component " + provider.to_string() +
+                                     " is not declared as Sealed<" + TinycompoDebug::type<Provider>() + ">.");
+        }
+        ref_user.set(user.prop, ptr_provider);
+    }
+};
+
 /*
 =============================================================================================================================
   ~*~ UseProvide class ~*~
@@ -1279,6 +4042,32 @@ struct Array : public Composite {
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ FlatArray class ~*~
+Same as Array, except that elements are stored contiguously in index order in a single buffer instead of being allocated one
+by one. Elements are regular instances of the composite (reachable through at() and usable with array connectors) and can
+also be iterated over directly through data() or element(). Components added to a FlatArray's model that are not elements of
+type T are allocated normally.
+===========================================================================================================================*/
+template <class T>
+class FlatArray : public Composite {
+    _ContiguousStorage<T>* contiguous_storage;
+
+  public:
+    FlatArray() : contiguous_storage(new _ContiguousStorage<T>()) {
+        set_storage(std::unique_ptr<_InstanceStorage>(contiguous_storage));
+    }
+
+    template <class... Args>
+    static void contents(Model& model, int nb_elems, Args&&... args) {
+        Array<T>::contents(model, nb_elems, std::forward<Args>(args)...);
+    }
+
+    T* data() const { return contiguous_storage->data(); }
+    T& element(int i) const { return data()[i]; }
+};
+
 /*
 =============================================================================================================================
   ~*~ ArraySet class ~*~
@@ -1298,21 +4087,27 @@ struct ArraySet {
 This is a connector that takes two arrays with identical sizes and connects (as if using the UseProvide connector) every
 i-th element in array1 to its corresponding element in array2 (ie, the i-th element in array2). This class should be used as
 a template parameter for Assembly::connect.
+Array connectors (ArrayOneToOne, MultiUse and MultiProvide) go through the elements declared in the model of an array (see
+Model::all_indices) rather than through indices 0 to size-1, so that they also apply to arrays holding only a subset of their
+elements, such as the local shard of a distributed array (see tinycompo_mpi.hpp).
 ===========================================================================================================================*/
 template <class Interface>
 struct ArrayOneToOne {
     static void _connect(Assembly& a, PortAddress array1, Address array2) {
         auto& ref1 = a.at<Assembly>(array1.address);
         auto& ref2 = a.at<Assembly>(array2);
-        if (ref1.size() == ref2.size()) {
-            for (int i = 0; i < static_cast<int>(ref1.size()); i++) {
-                auto ptr = dynamic_cast<Interface*>(&ref2.at(i));
-                ref1.at(i).set(array1.prop, ptr);
-            }
-        } else {
+        auto indices = ref1.get_model().all_indices();
+        if (ref1.size() != ref2.size()) {
             throw TinycompoException{"Array connection: mismatched sizes. " + array1.address.to_string() + " has size " +
                                      std::to_string(ref1.size()) + " while " + array2.to_string() + " has size " +
                                      std::to_string(ref2.size()) + '.'};
+        } else if (indices != ref2.get_model().all_indices()) {
+            throw TinycompoException{"Array connection: mismatched elements. " + array1.address.to_string() + " and " +
+                                     array2.to_string() + " do not have the same element indices."};
+        }
+        for (auto i : indices) {
+            auto ptr = dynamic_cast<Interface*>(&ref2.at(i));
+            ref1.at(i).set(array1.prop, ptr);
         }
     }
 };
@@ -1329,7 +4124,7 @@ struct MultiUse {
     static void _connect(Assembly& a, PortAddress reducer, Address array) {
         auto& ref1 = a.at<Component>(reducer.address);
         auto& ref2 = a.at<Assembly>(array);
-        for (int i = 0; i < static_cast<int>(ref2.size()); i++) {
+        for (auto i : ref2.get_model().all_indices()) {
             auto ptr = dynamic_cast<Interface*>(&ref2.at(i));
             ref1.set(reducer.prop, ptr);
         }
@@ -1344,8 +4139,10 @@ template <class Interface>
 struct MultiProvide {
     static void _connect(Assembly& a, PortAddress array, Address mapper) {
         try {
-            for (int i = 0; i < static_cast<int>(a.at<Assembly>(array.address).size()); i++) {
-                a.at(Address(array.address, i)).set(array.prop, &a.at<Interface>(mapper));
+            auto& array_ref = a.at<Assembly>(array.address);
+            auto& mapper_ref = a.at<Interface>(mapper);
+            for (auto i : array_ref.get_model().all_indices()) {
+                array_ref.at(i).set(array.prop, &mapper_ref);
             }
         } catch (...) {
             throw TinycompoException("<MultiProvide::_connect> There was an error while trying to connect components.");
@@ -1353,6 +4150,271 @@ struct MultiProvide {
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ UseTopoSort and UseNeighborhood classes ~*~
+Connectors that follow the graph of a composite's model (see ModelGraph), in O(V+E). A node that provides Interface is
+connected to the user port; a node that is itself a composite (eg, an array) is connected through all its elements (like
+MultiUse) if its first element provides Interface. UseTopoSort connects all such nodes, providers before users, including
+components of the composite that are not connected to anything.
+UseNeighborhood connects the nearest users of a target node that provide Interface, looking through nodes that do not (eg,
+the Markov blanket of a node in a graphical model whose nodes use their parents).
+===========================================================================================================================*/
+template <class Interface>
+struct _GraphUse {
+    static bool provides(Component& node) {
+        auto array = dynamic_cast<Assembly*>(&node);
+        if (array != nullptr) {
+            return array->size() > 0 and dynamic_cast<Interface*>(&array->at(0)) != nullptr;
+        }
+        return dynamic_cast<Interface*>(&node) != nullptr;
+    }
+
+    static void use_if_provides(Component& user, const std::string& prop, Component& node) {
+        auto array = dynamic_cast<Assembly*>(&node);
+        if (array == nullptr) {
+            auto ptr = dynamic_cast<Interface*>(&node);
+            if (ptr != nullptr) {
+                user.set(prop, ptr);
+            }
+        } else if (provides(node)) {
+            for (int i = 0; i < static_cast<int>(array->size()); i++) {
+                user.set(prop, dynamic_cast<Interface*>(&array->at(i)));
+            }
+        }
+    }
+};
+
+template <class Interface>
+struct UseTopoSort {
+    static void _connect(Assembly& assembly, PortAddress user, Address composite) {
+        auto& user_ref = assembly.at(user.address);
+        auto& composite_ref = assembly.at<Assembly>(composite);
+        auto& graph = composite_ref.get_model().graph();
+        for (auto node : graph.topological_order()) {
+            _GraphUse<Interface>::use_if_provides(user_ref, user.prop, composite_ref.at(graph.address(node)));
+        }
+    }
+};
+
+template <class Interface>
+struct UseNeighborhood {
+    static void _connect(Assembly& assembly, PortAddress user, Address composite, const std::string& target) {
+        auto& user_ref = assembly.at(user.address);
+        auto& composite_ref = assembly.at<Assembly>(composite);
+        auto& graph = composite_ref.get_model().graph();
+        if (!graph.contains(target)) {
+            return;  // target is not in the composite
+        }
+        auto keep = [&](const std::string& node) {
+            return _GraphUse<Interface>::provides(composite_ref.at(graph.address(graph.id(node))));
+        };
+        for (auto& node : graph.nearest_users(target, keep)) {
+            _GraphUse<Interface>::use_if_provides(user_ref, user.prop, composite_ref.at(graph.address(graph.id(node))));
+        }
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ Executor class ~*~
+Component owning a persistent pool of worker threads. parallel_for(n, f) calls f(0), ..., f(n-1) on the pool (the calling
+thread takes part in the work) and returns once all calls are done, rethrowing the first exception thrown by a call. Indices
+are first split into one contiguous range per thread; a thread that runs out of work steals the upper half of the range of
+another thread, so that uneven calls keep all threads busy. Calls to parallel_for from within a running parallel_for (on any
+thread of the pool) are executed serially by the calling thread.
+===========================================================================================================================*/
+class Executor : public Component {
+    using _Bounds = std::uint64_t;  // begin in the upper 32 bits, end in the lower 32 bits
+    static _Bounds pack(std::size_t begin, std::size_t end) { return (_Bounds(begin) << 32) | _Bounds(end); }
+    static std::size_t begin_of(_Bounds b) { return static_cast<std::size_t>(b >> 32); }
+    static std::size_t end_of(_Bounds b) { return static_cast<std::size_t>(b & 0xffffffff); }
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<std::atomic<_Bounds>[]> ranges;  // one per thread, index 0 being the calling thread
+
+    std::mutex run_mutex;  // one parallel_for at a time
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(std::size_t)>* job{nullptr};
+    std::size_t job_number{0};
+    int nb_running{0};
+    bool stopping{false};
+    std::exception_ptr error{nullptr};
+
+    static bool& inside_job() {
+        static thread_local bool inside{false};
+        return inside;
+    }
+
+    bool pop(int self, std::size_t& index) {
+        _Bounds b = ranges[self].load();
+        while (begin_of(b) < end_of(b)) {
+            if (ranges[self].compare_exchange_weak(b, pack(begin_of(b) + 1, end_of(b)))) {
+                index = begin_of(b);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool steal(int self) {
+        int nb = static_cast<int>(workers.size()) + 1;
+        for (int offset = 1; offset < nb; offset++) {
+            auto& victim = ranges[(self + offset) % nb];
+            _Bounds b = victim.load();
+            while (begin_of(b) < end_of(b)) {
+                std::size_t middle = begin_of(b) + (end_of(b) - begin_of(b)) / 2;
+                if (victim.compare_exchange_weak(b, pack(begin_of(b), middle))) {
+                    ranges[self].store(pack(middle, end_of(b)));  // own range is empty so nobody steals from it
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void work(int self) {
+        inside_job() = true;
+        std::size_t index;
+        while (true) {
+            if (not pop(self, index)) {
+                if (steal(self)) {
+                    continue;
+                }
+                break;
+            }
+            try {
+                (*job)(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        inside_job() = false;
+    }
+
+    void worker_loop(int self) {
+        std::size_t last_job = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping or job_number != last_job; });
+                if (stopping) {
+                    return;
+                }
+                last_job = job_number;
+            }
+            work(self);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--nb_running == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+  public:
+    explicit Executor(int nb_threads = static_cast<int>(std::thread::hardware_concurrency()))
+        : ranges(new std::atomic<_Bounds>[std::max(nb_threads, 1)]) {
+        for (int t = 1; t < nb_threads; t++) {
+            workers.emplace_back(&Executor::worker_loop, this, t);
+        }
+    }
+
+    ~Executor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    std::string debug() const override { return "Executor (" + std::to_string(nb_threads()) + " threads)"; }
+
+    int nb_threads() const { return static_cast<int>(workers.size()) + 1; }
+
+    void parallel_for(std::size_t n, const std::function<void(std::size_t)>& f) {
+        if (workers.empty() or n <= 1 or inside_job()) {
+            for (std::size_t i = 0; i < n; i++) {
+                f(i);
+            }
+            return;
+        }
+        if (n > 0xffffffff) {
+            throw TinycompoException("<Executor::parallel_for> Too many calls (" + std::to_string(n) + ")");
+        }
+        std::lock_guard<std::mutex> run_lock(run_mutex);
+        std::size_t nb = workers.size() + 1;
+        for (std::size_t t = 0; t < nb; t++) {
+            ranges[t].store(pack(t * n / nb, (t + 1) * n / nb));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            error = nullptr;
+            nb_running = static_cast<int>(workers.size());
+            job_number++;
+        }
+        wake.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return nb_running == 0; });
+        job = nullptr;
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+/*
+=============================================================================================================================
+  ~*~ ParallelMultiUse class ~*~
+Same as MultiUse, except that the user port receives (once) a ParallelGroup containing pointers to all elements of the array
+along with a pointer to an Executor component. The user component can then call a function on all elements in parallel
+through ParallelGroup::for_each. Without executor (null pointer), for_each is serial.
+===========================================================================================================================*/
+template <class Interface>
+class ParallelGroup {
+    std::vector<Interface*> _members;
+    Executor* _executor{nullptr};
+
+  public:
+    ParallelGroup() = default;
+    ParallelGroup(std::vector<Interface*> members, Executor* executor) : _members(std::move(members)), _executor(executor) {}
+
+    std::size_t size() const { return _members.size(); }
+    Interface* operator[](std::size_t i) const { return _members.at(i); }
+    typename std::vector<Interface*>::const_iterator begin() const { return _members.begin(); }
+    typename std::vector<Interface*>::const_iterator end() const { return _members.end(); }
+    Executor* executor() const { return _executor; }
+
+    template <class F>
+    void for_each(F f) const {  // f is called with an Interface*
+        if (_executor == nullptr) {
+            std::for_each(_members.begin(), _members.end(), f);
+        } else {
+            _executor->parallel_for(_members.size(), [&](std::size_t i) { f(_members[i]); });
+        }
+    }
+};
+
+template <class Interface>
+struct ParallelMultiUse {
+    static void _connect(Assembly& a, PortAddress user, Address array, Address executor) {
+        auto& array_ref = a.at<Assembly>(array);
+        std::vector<Interface*> members;
+        for (int i = 0; i < static_cast<int>(array_ref.size()); i++) {
+            members.push_back(dynamic_cast<Interface*>(&array_ref.at(i)));
+        }
+        a.at<Component>(user.address).set(user.prop, ParallelGroup<Interface>(members, &a.at<Executor>(executor)));
+    }
+};
+
 /*
 =============================================================================================================================
   ~*~ DriverConnect class ~*~
@@ -1388,10 +4450,46 @@ struct DriverConnect {
 
 template <class Target, class Lambda>
 inline _Operation::_Operation(Address address, _Type<Target>, Lambda lambda)
-    : _connect([lambda, address](Assembly& a) { lambda(a.at<Target>(address)); }), type("lambda") {}
+    : _connect([lambda, address](Assembly& a) { lambda(a.at<Target>(address)); }), type("lambda") {
+    neighbors.push_back(_GraphAddress(address));
+}
+
+template <class T>
+void _ContiguousStorage<T>::reset(const Model& model) {
+    nb_slots = model.size();
+    slots.reset(new Slot[nb_slots]);
+}
+
+inline void _ArenaStorage::reset(const Model& model) {
+    capacity = 0;
+    for (auto& c : model.components) {
+        capacity += nb_chunks(c.second);
+    }
+    for (auto& c : model.composites) {
+        capacity += nb_chunks(c.second.second);
+    }
+    block.reset(new Chunk[capacity]);
+    next = 0;
+}
+
+// cast tables depend on Assembly (see Interfaces)
+template <class T, class... Ts>
+_CastTable _make_cast_table(Interfaces<Ts...>) {
+    static_assert(_all_true<std::is_base_of<Ts, T>::value...>::value, "Declared interfaces must be bases of the component");
+    return _CastTable{{typeid(T), true},
+                      {typeid(Component), std::is_base_of<Component, T>::value},
+                      {typeid(Assembly), std::is_base_of<Assembly, T>::value},
+                      {typeid(Ts), true}...};
+}
+
+template <class T>
+const _CastTable& _cast_table() {
+    static const _CastTable table = _make_cast_table<T>(typename _declared_interfaces<T>::type());
+    return table;
+}
 
 // Address method that depends on ComponentReference
-inline Address::Address(const ComponentReference& ref) { keys = ref.component_address.keys; }
+inline Address::Address(const ComponentReference& ref) : Address(ref.component_address) {}
 
 // ComponentReference methods that depend on Model
 template <class T, class... Args>
@@ -1402,7 +4500,7 @@ inline ComponentReference& ComponentReference::connect(const std::string& port,
 
 template <class... Args>
 ComponentReference& ComponentReference::connect(Args&&... args) {
-    model_ref.connect<DriverConnect<Args...>>(component_address, std::forward<Args>(args)...);
+    model_ref.connect<DriverConnect<typename std::decay<Args>::type...>>(component_address, std::forward<Args>(args)...);
     return *this;
 }
 
@@ -1429,4 +4527,24 @@ inline _ProvidePort<Interface>::_ProvidePort(Assembly& assembly, PortAddress por
 
 }  // namespace tc
 
+#if defined(TINYCOMPO_COUNT_ALLOCATIONS) && defined(TINYCOMPO_IMPLEMENT_ALLOCATION_COUNTER)
+void* operator new(std::size_t size) {  // counts allocations for BuildReport (in a single translation unit, see BuildReport)
+    tc::_allocation_count()++;
+    void* result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+#endif
+
+namespace std {
+template <>
+struct hash<tc::Address> {  // allows addresses as keys of unordered containers
+    std::size_t operator()(const tc::Address& address) const { return address.hash(); }
+};
+}  // namespace std
+
 #endif  // TINYCOMPO_HPP
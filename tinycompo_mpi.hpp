@@ -27,6 +27,8 @@ its terms.*/
 #define TINYCOMPO_MPI_HPP
 
 #include <mpi.h>
+#include <array>
+#include <limits>
 #include "tinycompo.hpp"
 
 namespace tc {
@@ -60,6 +62,7 @@ class MPICore {
 struct MPIContext {
     static int rank, size, tag_counter;
     static MPI_Comm comm;
+    static constexpr int batch_tag_offset = 1 << 14;  // tags of batches (see MPIPort), MPI guarantees tags up to 32767
 
     MPIContext(int argc, char** argv) {
         int initialized;
@@ -80,6 +83,9 @@ struct MPIContext {
     static MPICore core() { return MPICore(rank, size, comm); }
 
     static int get_tag() {
+        if (tag_counter + 1 >= batch_tag_offset) {
+            throw TinycompoException("<MPIContext::get_tag> No more tags available");
+        }
         tag_counter++;
         return tag_counter;
     }
@@ -96,29 +102,107 @@ MPI_Comm MPIContext::comm{MPI_COMM_WORLD};
 /*
 =============================================================================================================================
   ~*~ ProcessSet ~*~
+  Set of process ranks, represented as a union of strided intervals (eg, odd processes are [1, +inf) with stride 2) so that
+  membership tests are cheap and members can be enumerated without testing every rank. Sets defined by an arbitrary predicate
+  are still supported but have to be enumerated by testing all ranks.
 ===========================================================================================================================*/
 struct ProcessSet {
-    std::function<bool(int)> contains;
-
-    ProcessSet() : contains([](int) { return false; }) {}
-    ProcessSet(int p) : contains([p](int i) { return i == p; }) {}
-    ProcessSet(int p, int q) : contains([p, q](int i) { return i >= p and i < q; }) {}
+    struct Interval {
+        int begin, end, stride;  // end is excluded
+        bool contains(int p) const { return p >= begin and p < end and (p - begin) % stride == 0; }
+    };
+    static constexpr int unbounded = std::numeric_limits<int>::max();
+
+    std::vector<Interval> intervals;
+    std::function<bool(int)> predicate;  // if set, replaces intervals
+
+    ProcessSet() = default;
+    ProcessSet(int p) : intervals({{p, p + 1, 1}}) {}
+    ProcessSet(int p, int q) : intervals({{p, q, 1}}) {}
     template <class F>
-    ProcessSet(F f) : contains(f) {}
+    ProcessSet(F f) : predicate(f) {}
+
+    static ProcessSet strided(int begin, int end, int stride) {
+        ProcessSet result;
+        result.intervals.push_back({begin, end, stride});
+        return result;
+    }
+
+    bool contains(int p) const {
+        if (predicate) {
+            return predicate(p);
+        }
+        for (auto& i : intervals) {
+            if (i.contains(p)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<int> members(int size) const {  // members lower than size, in increasing order
+        std::vector<int> result;
+        if (predicate) {
+            for (int p = 0; p < size; p++) {
+                if (predicate(p)) {
+                    result.push_back(p);
+                }
+            }
+            return result;
+        }
+        for (auto& i : intervals) {
+            int first = (i.begin >= 0) ? i.begin : i.begin + ((i.stride - 1 - i.begin) / i.stride) * i.stride;
+            for (int p = first; p < std::min(i.end, size); p += i.stride) {
+                result.push_back(p);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
 };
 
+/* Mapping from a process to another one (modulo the number of processes). Constant and offset mappings have a closed-form
+inverse, which makes all_origins proportional to the size of its result instead of the number of processes. */
 struct RelativeProcess {
-    std::function<int(int)> process_modifier;
+    enum Kind { constant, offset, function } kind;
+    int value{0};
+    std::function<int(int)> modifier;
 
+    RelativeProcess(Kind kind, int value) : kind(kind), value(value) {}
     template <class F>
-    RelativeProcess(F f) : process_modifier(f) {}
+    RelativeProcess(F f) : kind(function), modifier(f) {}
+
+    int process_modifier(int p) const {
+        switch (kind) {
+            case constant:
+                return value;
+            case offset:
+                return p + value;
+            default:
+                return modifier(p);
+        }
+    }
 
-    std::set<int> all_origins(ProcessSet processes) {
+    std::set<int> all_origins(const ProcessSet& processes) const {  // processes of the set that are mapped to this one
         auto core = MPIContext::core();
+        auto modulo = [&core](int p) { return ((p % core.size) + core.size) % core.size; };
         std::set<int> result;
-        for (auto p = 0; p < core.size; p++) {
-            if (processes.contains(p) and (process_modifier(p) % core.size) == core.rank) {
-                result.insert(p);
+        if (kind == constant) {
+            if (modulo(value) == core.rank) {
+                auto members = processes.members(core.size);
+                result.insert(members.begin(), members.end());
+            }
+        } else if (kind == offset) {
+            int origin = modulo(core.rank - value);
+            if (processes.contains(origin)) {
+                result.insert(origin);
+            }
+        } else {
+            for (auto p = 0; p < core.size; p++) {
+                if (processes.contains(p) and modulo(modifier(p)) == core.rank) {
+                    result.insert(p);
+                }
             }
         }
         return result;
@@ -126,44 +210,309 @@ struct RelativeProcess {
 };
 
 namespace process {
-    ProcessSet all{[](int) { return true; }};
-    ProcessSet odd{[](int i) { return i % 2 == 1; }};
-    ProcessSet even{[](int i) { return i % 2 == 0; }};
+    ProcessSet all = ProcessSet::strided(0, ProcessSet::unbounded, 1);
+    ProcessSet odd = ProcessSet::strided(1, ProcessSet::unbounded, 2);
+    ProcessSet even = ProcessSet::strided(0, ProcessSet::unbounded, 2);
     ProcessSet interval(int i, int j) { return ProcessSet{i, j}; }
     ProcessSet zero{0};
-    ProcessSet up_from(int p) {
-        return ProcessSet([p](int i) { return i >= p; });
-    }
+    ProcessSet up_from(int p) { return ProcessSet::strided(p, ProcessSet::unbounded, 1); }
 
-    RelativeProcess to(int p) {
-        return RelativeProcess([p](int) { return p; });
-    }
+    RelativeProcess to(int p) { return RelativeProcess(RelativeProcess::constant, p); }
     RelativeProcess to_zero = to(0);
-    RelativeProcess to_next([](int p) { return p + 1; });
+    RelativeProcess to_next(RelativeProcess::offset, 1);
 }  // namespace process
 
+/*
+=============================================================================================================================
+  ~*~ _MPIType ~*~
+  MPI datatype corresponding to a C++ type: predefined datatypes for arithmetic types, and for other trivially copyable types
+  a contiguous datatype of sizeof(T) bytes, created and committed on first use then cached (MPI frees it at finalization).
+===========================================================================================================================*/
+template <class T>
+struct _MPIType {
+    static_assert(std::is_trivially_copyable<T>::value, "MPI messages can only contain trivially copyable types");
+    static MPI_Datatype get() {
+        static MPI_Datatype datatype = []() {
+            MPI_Datatype result;
+            MPI_Type_contiguous(sizeof(T), MPI_BYTE, &result);
+            MPI_Type_commit(&result);
+            return result;
+        }();
+        return datatype;
+    }
+};
+
+#define TINYCOMPO_MPI_TYPE(T, DATATYPE)                \
+    template <>                                        \
+    struct _MPIType<T> {                               \
+        static MPI_Datatype get() { return DATATYPE; } \
+    };
+TINYCOMPO_MPI_TYPE(char, MPI_CHAR)
+TINYCOMPO_MPI_TYPE(signed char, MPI_SIGNED_CHAR)
+TINYCOMPO_MPI_TYPE(unsigned char, MPI_UNSIGNED_CHAR)
+TINYCOMPO_MPI_TYPE(short, MPI_SHORT)
+TINYCOMPO_MPI_TYPE(unsigned short, MPI_UNSIGNED_SHORT)
+TINYCOMPO_MPI_TYPE(int, MPI_INT)
+TINYCOMPO_MPI_TYPE(unsigned, MPI_UNSIGNED)
+TINYCOMPO_MPI_TYPE(long, MPI_LONG)
+TINYCOMPO_MPI_TYPE(unsigned long, MPI_UNSIGNED_LONG)
+TINYCOMPO_MPI_TYPE(long long, MPI_LONG_LONG)
+TINYCOMPO_MPI_TYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+TINYCOMPO_MPI_TYPE(float, MPI_FLOAT)
+TINYCOMPO_MPI_TYPE(double, MPI_DOUBLE)
+TINYCOMPO_MPI_TYPE(long double, MPI_LONG_DOUBLE)
+TINYCOMPO_MPI_TYPE(bool, MPI_CXX_BOOL)
+#undef TINYCOMPO_MPI_TYPE
+
+/*
+=============================================================================================================================
+  ~*~ MPIRequest ~*~
+  Handle on a non-blocking communication. It may own the communicated data (eg, a value sent by copy) until completion, and
+  waits for completion when destroyed since MPI forbids releasing buffers of pending communications.
+===========================================================================================================================*/
+class MPIRequest {
+    MPI_Request request{MPI_REQUEST_NULL};
+    std::vector<char> buffer;  // data owned by the request (moving a vector does not move its data)
+
+    friend class MPIPort;
+    friend class MPICommunicator;
+    friend void wait_all(std::vector<MPIRequest>& requests);
+
+  public:
+    MPIRequest() = default;
+    MPIRequest(const MPIRequest&) = delete;
+    MPIRequest(MPIRequest&& other) : request(other.request), buffer(std::move(other.buffer)) {
+        other.request = MPI_REQUEST_NULL;
+    }
+
+    MPIRequest& operator=(MPIRequest&& other) {
+        wait();
+        request = other.request;
+        buffer = std::move(other.buffer);
+        other.request = MPI_REQUEST_NULL;
+        return *this;
+    }
+
+    ~MPIRequest() { wait(); }
+
+    void wait() {
+        if (request != MPI_REQUEST_NULL) {
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+        }
+    }
+
+    bool test() {  // true if the communication is complete (also true for an empty request)
+        int flag;
+        MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+        return flag != 0;
+    }
+};
+
+inline void wait_all(std::vector<MPIRequest>& requests) {
+    std::vector<MPI_Request> raw_requests;
+    for (auto& r : requests) {
+        raw_requests.push_back(r.request);
+    }
+    MPI_Waitall(raw_requests.size(), raw_requests.data(), MPI_STATUSES_IGNORE);
+    for (auto& r : requests) {
+        r.request = MPI_REQUEST_NULL;
+    }
+}
+
 /*
 =============================================================================================================================
   ~*~ MPIPort ~*~
+  Point-to-point link with another process. Typed send/receive handle values of arithmetic or trivially copyable types (see
+  _MPIType), std::vector and std::array of such values: data is sent from and received into the user's storage without
+  intermediate copies (vectors are resized to the size of the incoming message). Ports also offer non-blocking operations
+  returning an MPIRequest, and coalescing of small messages: values pushed to a port are buffered and sent together by flush
+  (or automatically once batch_size values are buffered), and the receiving side gets each batch at once with receive_batch.
+  Batches are sent with a tag of their own so they cannot be mistaken for regular messages of the port. Pending values are
+  flushed when the port is destroyed or assigned to, they are moved along with the port, and copying a port that has pending
+  values throws (they would be sent twice).
 ===========================================================================================================================*/
 class MPIPort {
     int proc{-1};
     int tag{-1};
     MPICore core{MPIContext::core()};
+    std::vector<int> outgoing;  // pushed values not yet sent
+    std::size_t batch_size{256};
+
+    int batch_tag() const { return tag + MPIContext::batch_tag_offset; }
+
+    void check_nothing_pending(const std::string& function) const {
+        if (!outgoing.empty()) {
+            throw TinycompoException("<MPIPort::" + function + "> Trying to copy a port with " +
+                                     std::to_string(outgoing.size()) + " pushed values not flushed yet");
+        }
+    }
 
   public:
     MPIPort() = default;
     MPIPort(int p, int t) : proc(p), tag(t) {}
 
-    void send(int data) { MPI_Send(&data, 1, MPI_INT, proc, tag, core.comm); }
+    MPIPort(const MPIPort& other) : proc(other.proc), tag(other.tag), core(other.core), batch_size(other.batch_size) {
+        other.check_nothing_pending("MPIPort");
+    }
+
+    MPIPort(MPIPort&& other) noexcept
+        : proc(other.proc), tag(other.tag), core(other.core), outgoing(std::move(other.outgoing)),
+          batch_size(other.batch_size) {
+        other.outgoing.clear();
+    }
+
+    MPIPort& operator=(const MPIPort& other) {
+        if (this != &other) {
+            other.check_nothing_pending("operator=");
+            flush();
+            proc = other.proc;
+            tag = other.tag;
+            core = other.core;
+            batch_size = other.batch_size;
+        }
+        return *this;
+    }
+
+    MPIPort& operator=(MPIPort&& other) {
+        if (this != &other) {
+            flush();
+            proc = other.proc;
+            tag = other.tag;
+            core = other.core;
+            outgoing = std::move(other.outgoing);
+            other.outgoing.clear();
+            batch_size = other.batch_size;
+        }
+        return *this;
+    }
+
+    ~MPIPort() { flush(); }
+
     void send(void* data, int count, MPI_Datatype type) { MPI_Send(data, count, type, proc, tag, core.comm); }
 
-    void receive(int& data) { MPI_Recv(&data, 1, MPI_INT, proc, tag, core.comm, MPI_STATUS_IGNORE); }
     void receive(void* data, int count, MPI_Datatype type) {
         MPI_Recv(data, count, type, proc, tag, core.comm, MPI_STATUS_IGNORE);
     }
+
+    template <class T>
+    void send(const T& data) {
+        MPI_Send(&data, 1, _MPIType<T>::get(), proc, tag, core.comm);
+    }
+
+    template <class T>
+    void send(const std::vector<T>& data) {
+        MPI_Send(data.data(), data.size(), _MPIType<T>::get(), proc, tag, core.comm);
+    }
+
+    template <class T, std::size_t N>
+    void send(const std::array<T, N>& data) {
+        MPI_Send(data.data(), N, _MPIType<T>::get(), proc, tag, core.comm);
+    }
+
+    template <class T>
+    void receive(T& data) {
+        MPI_Recv(&data, 1, _MPIType<T>::get(), proc, tag, core.comm, MPI_STATUS_IGNORE);
+    }
+
+    template <class T>
+    void receive(std::vector<T>& data) {  // size of the message is obtained by probing it
+        MPI_Status status;
+        MPI_Probe(proc, tag, core.comm, &status);
+        int count;
+        MPI_Get_count(&status, _MPIType<T>::get(), &count);
+        data.resize(count);
+        MPI_Recv(data.data(), count, _MPIType<T>::get(), proc, tag, core.comm, MPI_STATUS_IGNORE);
+    }
+
+    template <class T, std::size_t N>
+    void receive(std::array<T, N>& data) {
+        MPI_Recv(data.data(), N, _MPIType<T>::get(), proc, tag, core.comm, MPI_STATUS_IGNORE);
+    }
+
+    // non-blocking operations (buffers passed by pointer or reference must stay valid until completion)
+    template <class T>
+    MPIRequest isend(const T& data) {  // data is copied into the request
+        MPIRequest result;
+        result.buffer.resize(sizeof(T));
+        memcpy(result.buffer.data(), &data, sizeof(T));
+        MPI_Isend(result.buffer.data(), 1, _MPIType<T>::get(), proc, tag, core.comm, &result.request);
+        return result;
+    }
+
+    MPIRequest isend(const void* data, int count, MPI_Datatype type) {
+        MPIRequest result;
+        MPI_Isend(data, count, type, proc, tag, core.comm, &result.request);
+        return result;
+    }
+
+    MPIRequest irecv(void* data, int count, MPI_Datatype type) {
+        MPIRequest result;
+        MPI_Irecv(data, count, type, proc, tag, core.comm, &result.request);
+        return result;
+    }
+
+    template <class T>
+    MPIRequest isend(const std::vector<T>& data) {  // data is not copied
+        return isend(data.data(), data.size(), _MPIType<T>::get());
+    }
+
+    template <class T, std::size_t N>
+    MPIRequest isend(const std::array<T, N>& data) {
+        return isend(data.data(), N, _MPIType<T>::get());
+    }
+
+    template <class T>
+    MPIRequest irecv(T& data) {
+        return irecv(&data, 1, _MPIType<T>::get());
+    }
+
+    template <class T>
+    MPIRequest irecv(std::vector<T>& data) {  // data must already have the size of the incoming message
+        return irecv(data.data(), data.size(), _MPIType<T>::get());
+    }
+
+    template <class T, std::size_t N>
+    MPIRequest irecv(std::array<T, N>& data) {
+        return irecv(data.data(), N, _MPIType<T>::get());
+    }
+
+    // coalescing
+    void set_batch_size(std::size_t size) { batch_size = std::max<std::size_t>(1, size); }
+
+    void push(int data) {
+        outgoing.push_back(data);
+        if (outgoing.size() >= batch_size) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!outgoing.empty()) {
+            MPI_Send(outgoing.data(), outgoing.size(), MPI_INT, proc, batch_tag(), core.comm);
+            outgoing.clear();
+        }
+    }
+
+    void receive_batch(std::vector<int>& data) {  // size of the batch is obtained by probing the incoming message
+        MPI_Status status;
+        MPI_Probe(proc, batch_tag(), core.comm, &status);
+        int count;
+        MPI_Get_count(&status, MPI_INT, &count);
+        data.resize(count);
+        MPI_Recv(data.data(), count, MPI_INT, proc, batch_tag(), core.comm, MPI_STATUS_IGNORE);
+    }
 };
 
+inline std::vector<int> receive_all(std::vector<MPIPort>& ports) {  // one int from each port, received concurrently
+    std::vector<int> result(ports.size(), 0);
+    std::vector<MPIRequest> requests;
+    for (std::size_t i = 0; i < ports.size(); i++) {
+        requests.push_back(ports[i].irecv(result[i]));
+    }
+    wait_all(requests);
+    return result;
+}
+
 struct P2P {
     static void connect(Model& model, int tag, PortAddress user, ProcessSet user_process, PortAddress provider,
                         RelativeProcess provider_process) {
@@ -199,9 +548,33 @@ struct CondCompo : Meta {
     }
 };
 
+/* Communicator over a subset of processes. Collective operations take caller-provided output buffers (vectors are resized
+if needed), reductions are restricted to arithmetic types (elementwise for vectors) and non-blocking variants return an
+MPIRequest. Collectives must be called by all members, and throw on processes that are not members. */
 class MPICommunicator : public Component {
     MPI_Comm communicator;
     MPICore core;
+    int comm_rank{-1}, comm_size{0};
+
+    void check(const std::string& operation) const {
+        if (communicator == MPI_COMM_NULL) {
+            throw TinycompoException("<MPICommunicator::" + operation + "> Process " + std::to_string(core.rank) +
+                                     " is not a member of the communicator");
+        }
+    }
+
+    template <class T>
+    static void check_reducible() {
+        static_assert(std::is_arithmetic<T>::value, "MPI reductions are only supported for arithmetic types");
+    }
+
+    std::vector<int> displacements(const std::vector<int>& counts) const {
+        std::vector<int> result(counts.size(), 0);
+        for (std::size_t i = 1; i < counts.size(); i++) {
+            result[i] = result[i - 1] + counts[i - 1];
+        }
+        return result;
+    }
 
   public:
     MPICommunicator(ProcessSet set) : core(MPIContext::core()) {
@@ -217,16 +590,183 @@ class MPICommunicator : public Component {
         MPI_Comm_create(core.comm, new_group, &communicator);
         MPI_Group_free(&world_group);
         MPI_Group_free(&new_group);
+        if (communicator != MPI_COMM_NULL) {
+            MPI_Comm_rank(communicator, &comm_rank);
+            MPI_Comm_size(communicator, &comm_size);
+        }
     }
 
+    ~MPICommunicator() {
+        if (communicator != MPI_COMM_NULL) MPI_Comm_free(&communicator);
+    }
+
+    bool member() const { return communicator != MPI_COMM_NULL; }
+    int rank() const { return comm_rank; }  // rank in the communicator (-1 if not a member)
+    int size() const { return comm_size; }
+
+    // gather
     std::vector<int> all_gather(int data_send) {
-        std::vector<int> result(core.size, 0);
-        MPI_Allgather(&data_send, 1, MPI_INT, result.data(), 1, MPI_INT, communicator);
+        std::vector<int> result;
+        all_gather(data_send, result);
         return result;
     }
 
-    ~MPICommunicator() {
-        if (communicator != MPI_COMM_NULL) MPI_Comm_free(&communicator);
+    template <class T>
+    void all_gather(const T& data_send, std::vector<T>& result) {
+        check("all_gather");
+        result.resize(comm_size);
+        MPI_Allgather(&data_send, 1, _MPIType<T>::get(), result.data(), 1, _MPIType<T>::get(), communicator);
+    }
+
+    template <class T>  // concatenation of the data of all members, in rank order, on root
+    void gatherv(const std::vector<T>& data_send, std::vector<T>& result, int root = 0) {
+        check("gatherv");
+        int count = data_send.size();
+        std::vector<int> counts(comm_rank == root ? comm_size : 0);
+        MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, root, communicator);
+        auto displs = displacements(counts);
+        if (comm_rank == root) {
+            result.resize(std::accumulate(counts.begin(), counts.end(), 0));
+        }
+        MPI_Gatherv(data_send.data(), count, _MPIType<T>::get(), result.data(), counts.data(), displs.data(),
+                    _MPIType<T>::get(), root, communicator);
+    }
+
+    // scatter / broadcast / all-to-all
+    template <class T>  // member i receives counts[i] elements of data_send (counts and data_send only read on root)
+    void scatterv(const std::vector<T>& data_send, const std::vector<int>& counts, std::vector<T>& result,
+                  int root = 0) {
+        check("scatterv");
+        int count;
+        MPI_Scatter(counts.data(), 1, MPI_INT, &count, 1, MPI_INT, root, communicator);
+        result.resize(count);
+        auto displs = displacements(counts);
+        MPI_Scatterv(data_send.data(), counts.data(), displs.data(), _MPIType<T>::get(), result.data(), count,
+                     _MPIType<T>::get(), root, communicator);
+    }
+
+    template <class T>
+    void bcast(T& data, int root = 0) {
+        check("bcast");
+        MPI_Bcast(&data, 1, _MPIType<T>::get(), root, communicator);
+    }
+
+    template <class T>  // vector is resized to the size of the root's vector
+    void bcast(std::vector<T>& data, int root = 0) {
+        check("bcast");
+        int count = data.size();
+        MPI_Bcast(&count, 1, MPI_INT, root, communicator);
+        data.resize(count);
+        MPI_Bcast(data.data(), count, _MPIType<T>::get(), root, communicator);
+    }
+
+    template <class T>  // data_send is split in size() blocks of equal size, block i going to member i
+    void alltoall(const std::vector<T>& data_send, std::vector<T>& result) {
+        check("alltoall");
+        if (data_send.size() % comm_size != 0) {
+            throw TinycompoException("<MPICommunicator::alltoall> Data size " + std::to_string(data_send.size()) +
+                                     " is not a multiple of communicator size " + std::to_string(comm_size));
+        }
+        int block = data_send.size() / comm_size;
+        result.resize(data_send.size());
+        MPI_Alltoall(data_send.data(), block, _MPIType<T>::get(), result.data(), block, _MPIType<T>::get(),
+                     communicator);
+    }
+
+    // reductions
+    template <class T>
+    void allreduce(const T& data_send, T& result, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("allreduce");
+        MPI_Allreduce(&data_send, &result, 1, _MPIType<T>::get(), op, communicator);
+    }
+
+    template <class T>
+    void allreduce(const std::vector<T>& data_send, std::vector<T>& result, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("allreduce");
+        result.resize(data_send.size());
+        MPI_Allreduce(data_send.data(), result.data(), data_send.size(), _MPIType<T>::get(), op, communicator);
+    }
+
+    template <class T>
+    void allreduce(std::vector<T>& data, MPI_Op op = MPI_SUM) {  // in place
+        check_reducible<T>();
+        check("allreduce");
+        MPI_Allreduce(MPI_IN_PLACE, data.data(), data.size(), _MPIType<T>::get(), op, communicator);
+    }
+
+    template <class T>  // result is only written on root
+    void reduce(const T& data_send, T& result, int root = 0, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("reduce");
+        MPI_Reduce(&data_send, &result, 1, _MPIType<T>::get(), op, root, communicator);
+    }
+
+    template <class T>
+    void reduce(const std::vector<T>& data_send, std::vector<T>& result, int root = 0, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("reduce");
+        if (comm_rank == root) {
+            result.resize(data_send.size());
+        }
+        MPI_Reduce(data_send.data(), result.data(), data_send.size(), _MPIType<T>::get(), op, root, communicator);
+    }
+
+    // non-blocking variants (buffers must stay valid and vectors keep their size until completion)
+    template <class T>
+    MPIRequest iallreduce(const T& data_send, T& result, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("iallreduce");
+        MPIRequest request;
+        MPI_Iallreduce(&data_send, &result, 1, _MPIType<T>::get(), op, communicator, &request.request);
+        return request;
+    }
+
+    template <class T>
+    MPIRequest iallreduce(const std::vector<T>& data_send, std::vector<T>& result, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("iallreduce");
+        result.resize(data_send.size());
+        MPIRequest request;
+        MPI_Iallreduce(data_send.data(), result.data(), data_send.size(), _MPIType<T>::get(), op, communicator,
+                       &request.request);
+        return request;
+    }
+
+    template <class T>
+    MPIRequest ireduce(const T& data_send, T& result, int root = 0, MPI_Op op = MPI_SUM) {
+        check_reducible<T>();
+        check("ireduce");
+        MPIRequest request;
+        MPI_Ireduce(&data_send, &result, 1, _MPIType<T>::get(), op, root, communicator, &request.request);
+        return request;
+    }
+
+    template <class T>
+    MPIRequest ibcast(T& data, int root = 0) {
+        check("ibcast");
+        MPIRequest request;
+        MPI_Ibcast(&data, 1, _MPIType<T>::get(), root, communicator, &request.request);
+        return request;
+    }
+
+    template <class T>  // vectors must already have the same size on all members
+    MPIRequest ibcast(std::vector<T>& data, int root = 0) {
+        check("ibcast");
+        MPIRequest request;
+        MPI_Ibcast(data.data(), data.size(), _MPIType<T>::get(), root, communicator, &request.request);
+        return request;
+    }
+
+    template <class T>
+    MPIRequest iall_gather(const T& data_send, std::vector<T>& result) {
+        check("iall_gather");
+        result.resize(comm_size);
+        MPIRequest request;
+        MPI_Iallgather(&data_send, 1, _MPIType<T>::get(), result.data(), 1, _MPIType<T>::get(), communicator,
+                       &request.request);
+        return request;
     }
 };
 
@@ -239,6 +779,114 @@ struct UseComm : Meta {
     }
 };
 
+/*
+=============================================================================================================================
+  ~*~ Distributed arrays ~*~
+  A DistributedArray is an Array whose elements are partitioned across processes (by contiguous blocks, or cyclically): each
+  process only declares and instantiates its local elements, under their global index (so Address("array", i) is valid on
+  the owner of element i only). The usual array connectors (ArrayOneToOne, MultiUse and MultiProvide) go through the
+  elements an array actually holds, so they apply unchanged to distributed arrays and wire local elements to local
+  components. Arrays connected one-to-one must have the same size and partition so that corresponding elements live on the
+  same process (ArrayOneToOne throws otherwise).
+  Scope: connections are only rewritten into local wiring plus reductions. No halo or ghost exchange is generated, since
+  interfaces are arbitrary classes for which no proxy of a remote element can be built: an element can only be connected
+  to elements of its own process. A reduction over the whole array is obtained by connecting a DistributedReduction to the
+  array with MultiUse and to a communicator, which combines the values of local elements and then those of all shards.
+===========================================================================================================================*/
+struct Partition {
+    enum Kind { block, cyclic } kind;
+
+    Partition(Kind kind = block) : kind(kind) {}
+
+    int owner(int index, int nb_elems, int nb_procs) const {
+        if (kind == cyclic) {
+            return index % nb_procs;
+        }
+        int q = nb_elems / nb_procs, r = nb_elems % nb_procs;  // the first r processes get q + 1 elements
+        return (index < r * (q + 1)) ? index / (q + 1) : r + (index - r * (q + 1)) / q;
+    }
+
+    std::vector<int> local_indices(int rank, int nb_elems, int nb_procs) const {
+        std::vector<int> result;
+        if (kind == cyclic) {
+            for (int i = rank; i < nb_elems; i += nb_procs) {
+                result.push_back(i);
+            }
+        } else {
+            int q = nb_elems / nb_procs, r = nb_elems % nb_procs;
+            int begin = rank * q + std::min(rank, r), end = begin + q + (rank < r ? 1 : 0);
+            for (int i = begin; i < end; i++) {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+};
+
+template <class T>
+struct DistributedArray : public Composite {
+    template <class... Args>
+    static void contents(Model& model, int nb_elems, Partition partition, Args&&... args) {
+        auto core = MPIContext::core();
+        for (auto i : partition.local_indices(core.rank, nb_elems, core.size)) {
+            model.component<T>(i, std::forward<Args>(args)...);
+        }
+    }
+
+    std::vector<int> indices() const { return get_model().all_indices(); }  // global indices of local elements, increasing
+};
+
+/* Distributed counterpart of a MultiUse reducer: elements of the local shard are connected to port "ptr" (through
+MultiUse) and a communicator grouping the processes holding the array to port "comm". get() applies value to
+each local element, combines the results with op and then combines the results of all shards with an allreduce, so it is a
+collective call that returns the same value on every member. identity is the result of processes without local elements,
+and must be neutral for op (eg, 0 for MPI_SUM, the lowest value for MPI_MAX). */
+template <class Interface, class T>
+class DistributedReduction : public Component {
+    std::vector<Interface*> elements;
+    MPICommunicator* comm{nullptr};
+    std::function<T(Interface&)> value;
+    MPI_Op op;
+    T identity;
+    T local_result;  // kept alive for non-blocking reductions
+
+    void add_element(Interface* ptr) { elements.push_back(ptr); }
+    void set_comm(MPICommunicator* ptr) { comm = ptr; }
+
+    void reduce_local() {
+        if (comm == nullptr) {
+            throw TinycompoException("<DistributedReduction::get> Port comm of " + get_name() + " is not connected");
+        }
+        local_result = identity;
+        for (auto element : elements) {
+            T v = value(*element);
+            MPI_Reduce_local(&v, &local_result, 1, _MPIType<T>::get(), op);
+        }
+    }
+
+  public:
+    DistributedReduction(std::function<T(Interface&)> value, MPI_Op op = MPI_SUM, T identity = T())
+        : value(value), op(op), identity(identity) {
+        static_assert(std::is_arithmetic<T>::value, "MPI reductions are only supported for arithmetic types");
+        port("ptr", &DistributedReduction::add_element);
+        port("comm", &DistributedReduction::set_comm);
+    }
+
+    std::size_t local_size() const { return elements.size(); }
+
+    T get() {
+        reduce_local();
+        T result;
+        comm->allreduce(local_result, result, op);
+        return result;
+    }
+
+    MPIRequest iget(T& result) {  // non-blocking get, no other get may be started before completion
+        reduce_local();
+        return comm->iallreduce(local_result, result, op);
+    }
+};
+
 /*
 =============================================================================================================================
   ~*~ MPI Model ~*~
@@ -258,6 +906,11 @@ class MPIModel {
         model.component<CondCompo<T>>(address, process, std::forward<Args>(args)...);
     }
 
+    template <class C, class... Args>
+    void connect(Args&&... args) {
+        model.connect<C>(std::forward<Args>(args)...);
+    }
+
     template <class T, class... Args>
     void mpi_connect(Args&&... args) {
         model.connect<T>(MPIContext::get_tag(), std::forward<Args>(args)...);
@@ -275,10 +928,46 @@ class MPIAssembly : public Component {
     MPICore core;
 
   public:
-    MPIAssembly(MPIModel model) : assembly(model.model), core(MPIContext::core()) {}
+    MPIAssembly(MPIModel model) : assembly(std::move(model.model)), core(MPIContext::core()) {}
 
+  private:
+    /* Runs f on every process and returns once all processes are done. If f throws on any process, throws on every process
+    (instead of leaving the other ones blocked in a later collective), with the local error message if there is one. */
+    template <class F>
+    void collectively(const std::string& function, F f) {
+        std::string error;
+        try {
+            f();
+        } catch (std::exception& e) {
+            error = e.what();
+        }
+        int failed = error.empty() ? 0 : 1, nb_failed = 0;
+        MPI_Allreduce(&failed, &nb_failed, 1, MPI_INT, MPI_SUM, core.comm);
+        if (nb_failed > 0) {
+            throw TinycompoException("<MPIAssembly::" + function + "> Failed on " + std::to_string(nb_failed) +
+                                     " process(es)" + (error.empty() ? "" : ": " + error));
+        }
+    }
+
+  public:
     void barrier() { MPI_Barrier(core.comm); }
 
+    /* Each process writes the state of its own components (see Assembly::checkpoint) to file_prefix.<rank>. Returns once
+    all processes are done, so the checkpoint is complete as soon as checkpoint returns on any process. Throws on all
+    processes if it failed on one of them. */
+    void checkpoint(const std::string& file_prefix) {
+        collectively("checkpoint", [&]() { assembly.checkpoint(file_prefix + "." + std::to_string(core.rank)); });
+    }
+
+    void restore(const std::string& file_prefix) {  // from a checkpoint made with the same model and number of processes
+        collectively("restore", [&]() { assembly.restore(file_prefix + "." + std::to_string(core.rank)); });
+    }
+
+    template <class T = Component>
+    T& at(const Address& address) const {  // only valid for components instantiated on this process
+        return assembly.at<T>(address);
+    }
+
     void call(PortAddress port, ProcessSet processes) {
         if (processes.contains(core.rank)) {
             assembly.call(port);